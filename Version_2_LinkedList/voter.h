@@ -23,6 +23,7 @@ class VoterList {
 private:
     VoterNode* head;
     int count;
+    int votedCount;     // kept by markAsVoted, so turnout needs no list walk
     
     // Helper function to find voter by ID
     VoterNode* findVoter(int id) {
@@ -37,7 +38,7 @@ private:
     }
     
 public:
-    VoterList() : head(nullptr), count(0) {}
+    VoterList() : head(nullptr), count(0), votedCount(0) {}
     
     // Destructor to free memory
     ~VoterList() {
@@ -107,7 +108,10 @@ public:
         if (voter == nullptr) {
             return false;
         }
-        voter->hasVoted = true;
+        if (!voter->hasVoted) {
+            voter->hasVoted = true;
+            votedCount++;
+        }
         return true;
     }
     
@@ -118,14 +122,6 @@ public:
     
     // Get count of voters who have voted
     int getVotedCount() const {
-        int votedCount = 0;
-        VoterNode* current = head;
-        while (current != nullptr) {
-            if (current->hasVoted) {
-                votedCount++;
-            }
-            current = current->next;
-        }
         return votedCount;
     }
     
@@ -18,7 +18,7 @@ private:
     Graph* voterNetwork;
     int graphSize;
     int nextGraphIndex;
-    
+
 public:
     VotingSystem() {
         graphSize = 10000;  // Max voters
@@ -132,6 +132,7 @@ public:
         candidate->voteCount++;
         voter->hasVoted = true;
         voter->votedFor = candidateId;
+        regions[voter->regionId]->recordVote(candidate);
         
         cout << "\n   ✅ Vote cast successfully!\n";
         cout << "   Voter: " << voter->name << "\n";
@@ -162,6 +163,10 @@ public:
         
         cout << "   🏆 WINNER: " << winner->name << " (" << winner->party << ")\n";
         cout << "   Votes: " << winner->voteCount << "\n";
+        if (region->getRunnerUp()) {
+            cout << "   Runner-up: " << region->getRunnerUp()->name 
+                 << " | Margin: " << region->getMargin() << " votes\n";
+        }
         cout << "   ───────────────────────────────────────────────────────────\n";
         cout << "   " << left << setw(25) << "Candidate" 
              << setw(20) << "Party" 
@@ -346,7 +351,16 @@ public:
             Candidate* winner = r->getWinner();
             
             cout << "\n   Region: " << r->getName() << "\n";
+            if (!winner) {
+                cout << "   No candidates yet.\n";
+                cout << "   ───────────────────────────────────────────────────────────\n";
+                continue;
+            }
             cout << "   Winner: " << winner->name << " (" << winner->party << ")\n";
+            if (r->getRunnerUp()) {
+                cout << "   Runner-up: " << r->getRunnerUp()->name 
+                     << " (margin " << r->getMargin() << ")\n";
+            }
             cout << "   Total Votes: " << r->getTotalVotes() << "\n";
             cout << "   Turnout: " << fixed << setprecision(2) 
                  << r->getTurnout() << "%\n";
@@ -18,9 +18,20 @@ private:
     vector<Voter*> voters;
     unordered_map<int, Candidate*> candidateMap;
     unordered_map<int, Voter*> voterMap;
+    int votedCount;     // kept by recordVote, so turnout needs no voter scan
+    int totalVotes;     // likewise for getTotalVotes
     
+    // The TOP_K candidates with the most votes, most first; ties go to
+    // the one registered first, as getWinner's scan always did. A vote
+    // adds one to one candidate, so recordVote only has to bubble it up
+    // this short list (or let it in past the last entry): O(k) per vote,
+    // and winner/runner-up/margin are O(1).
+    static const int TOP_K = 3;
+    vector<Candidate*> leaders;
+    unordered_map<int, int> registration;  // candidate id -> order added
+
 public:
-    Region(int i, string n) : id(i), name(n) {}
+    Region(int i, string n) : id(i), name(n), votedCount(0), totalVotes(0) {}
     
     int getId() const { return id; }
     string getName() const { return name; }
@@ -28,11 +39,38 @@ public:
     void addCandidate(Candidate* c) {
         candidates.push_back(c);
         candidateMap[c->id] = c;
+        registration[c->id] = candidates.size() - 1;
+        totalVotes += c->voteCount;
+        if ((int)leaders.size() < TOP_K) {
+            leaders.push_back(c);
+        } else if (ahead(c, leaders.back())) {
+            leaders.back() = c;
+        } else {
+            return;
+        }
+        promote(leaders.size() - 1);
     }
     
     void addVoter(Voter* v) {
         voters.push_back(v);
         voterMap[v->id] = v;
+        if (v->hasVoted) votedCount++;
+    }
+    
+    // Called after one of this region's voters voted for c (whose
+    // voteCount has already been bumped)
+    void recordVote(Candidate* c) {
+        votedCount++;
+        totalVotes++;
+        
+        size_t pos = 0;
+        while (pos < leaders.size() && leaders[pos] != c) pos++;
+        if (pos == leaders.size()) {
+            if (!ahead(c, leaders.back())) return;
+            pos = leaders.size() - 1;
+            leaders[pos] = c;
+        }
+        promote(pos);
     }
     
     Candidate* getCandidateById(int id) {
@@ -50,36 +88,46 @@ public:
     }
     
     Candidate* getWinner() {
-        if (candidates.empty()) return nullptr;
-        
-        Candidate* winner = candidates[0];
-        for (auto c : candidates) {
-            if (c->voteCount > winner->voteCount) {
-                winner = c;
-            }
-        }
-        return winner;
+        return leaders.empty() ? nullptr : leaders[0];
     }
     
+    Candidate* getRunnerUp() {
+        return (leaders.size() < 2) ? nullptr : leaders[1];
+    }
+    
+    // Winner's lead over the runner-up (0 with fewer than two candidates)
+    int getMargin() {
+        return (leaders.size() < 2) ? 0 : leaders[0]->voteCount - leaders[1]->voteCount;
+    }
+    
+    const vector<Candidate*>& getLeaders() const { return leaders; }
+    
     int getTotalVotes() {
-        int total = 0;
-        for (auto c : candidates) {
-            total += c->voteCount;
-        }
-        return total;
+        return totalVotes;
     }
     
     double getTurnout() {
         if (voters.empty()) return 0.0;
-        int voted = 0;
-        for (auto v : voters) {
-            if (v->hasVoted) voted++;
-        }
-        return (voted * 100.0) / voters.size();
+        return (votedCount * 100.0) / voters.size();
     }
     
     vector<Candidate*>& getCandidates() { return candidates; }
     vector<Voter*>& getVoters() { return voters; }
+
+private:
+    // More votes, or as many and registered earlier
+    bool ahead(Candidate* a, Candidate* b) {
+        if (a->voteCount != b->voteCount) return a->voteCount > b->voteCount;
+        return registration[a->id] < registration[b->id];
+    }
+    
+    // Move leaders[pos] up past anyone it is now ahead of
+    void promote(size_t pos) {
+        while (pos > 0 && ahead(leaders[pos], leaders[pos - 1])) {
+            swap(leaders[pos], leaders[pos - 1]);
+            pos--;
+        }
+    }
 };
 
 #endif
@@ -2,133 +2,93 @@
 #define ANALYTICS_H
 
 #include "database.h"
+#include "histogram.h"
+#include "projection.h"
 #include <vector>
 #include <map>
 #include <set>
 #include <algorithm>
 #include <cmath>
+#include <chrono>
 
 using namespace std;
 
+// Aggregates behind the comprehensive report, gathered in one pass over
+// the voters and one over the candidates (see ElectionAnalytics::aggregate)
+struct ReportAggregates {
+    AgeHistogram ages;      // brackets and turnout per bracket
+    int totalVotes;         // over all candidates
+    
+    explicit ReportAggregates(const vector<int>& ageEdges = AgeHistogram::standardEdges())
+        : ages(ageEdges), totalVotes(0) {}
+};
+
+// Every analysis runs on an ElectionView, a consistent point-in-time copy
+// of the database, so it never races with (or holds up) castVote. The
+// no-argument versions take a fresh view; generateComprehensiveReport
+// shares one view across all its sections.
 class ElectionAnalytics {
 private:
     ElectionDatabase* db;
-    
+    vector<int> ageEdges;   // lower edges of the age brackets
+    size_t projectionTrials;
+
 public:
-    ElectionAnalytics(ElectionDatabase* database) : db(database) {}
+    ElectionAnalytics(ElectionDatabase* database) 
+        : db(database), ageEdges(AgeHistogram::standardEdges()), projectionTrials(10000) {}
     
-    // Analyze voting patterns by age group
-    void analyzeByAgeGroup() {
-        map<string, int> ageGroups;
-        ageGroups["18-25"] = 0;
-        ageGroups["26-35"] = 0;
-        ageGroups["36-50"] = 0;
-        ageGroups["51-65"] = 0;
-        ageGroups["65+"] = 0;
-        
-        map<string, int> votedInGroup;
-        votedInGroup["18-25"] = 0;
-        votedInGroup["26-35"] = 0;
-        votedInGroup["36-50"] = 0;
-        votedInGroup["51-65"] = 0;
-        votedInGroup["65+"] = 0;
-        
-        for (const auto& voter : db->getAllVoters()) {
-            string group;
-            if (voter.age >= 18 && voter.age <= 25) group = "18-25";
-            else if (voter.age >= 26 && voter.age <= 35) group = "26-35";
-            else if (voter.age >= 36 && voter.age <= 50) group = "36-50";
-            else if (voter.age >= 51 && voter.age <= 65) group = "51-65";
-            else group = "65+";
-            
-            ageGroups[group]++;
-            if (voter.hasVoted) {
-                votedInGroup[group]++;
-            }
+    // Age brackets for age analyses, as ascending lower edges
+    bool setAgeBrackets(const vector<int>& lowerEdges) {
+        if (lowerEdges.empty() || !AgeHistogram::validEdges(lowerEdges)) {
+            return false;
         }
-        
-        cout << "\n" << string(70, '=') << "\n";
-        cout << "           AGE GROUP VOTING ANALYSIS\n";
-        cout << string(70, '=') << "\n";
-        cout << left << setw(15) << "Age Group"
-             << setw(20) << "Total Voters"
-             << setw(20) << "Voted"
-             << setw(15) << "Turnout" << "\n";
-        cout << string(70, '=') << "\n";
-        
-        for (const auto& pair : ageGroups) {
-            double turnout = (pair.second > 0) ? 
-                (votedInGroup[pair.first] * 100.0 / pair.second) : 0.0;
-            
-            cout << left << setw(15) << pair.first
-                 << setw(20) << pair.second
-                 << setw(20) << votedInGroup[pair.first]
-                 << fixed << setprecision(2)
-                 << turnout << "%\n";
-        }
-        cout << string(70, '=') << "\n";
+        ageEdges = lowerEdges;
+        return true;
+    }
+    const vector<int>& getAgeBrackets() const { return ageEdges; }
+    
+    // Simulated completions behind predictWinner's projection (0 = none).
+    // The default 10,000 puts win chances within about 1% (95% interval).
+    void setProjectionTrials(size_t trials) { projectionTrials = trials; }
+    
+    // Analyze voting patterns by age group
+    void analyzeByAgeGroup() { analyzeByAgeGroup(db->createView()); }
+    
+    void analyzeByAgeGroup(const ElectionView& view) {
+        ReportAggregates totals(ageEdges);
+        tallyVoters(view, totals);
+        printAgeGroups(totals);
     }
     
     // Analyze party performance by region
-    void analyzePartyByRegion() {
-        map<string, map<string, int>> regionPartyVotes;
-        
-        for (const auto& candidate : db->getAllCandidates()) {
-            regionPartyVotes[candidate.region][candidate.party] += candidate.votes;
-        }
-        
-        cout << "\n" << string(80, '=') << "\n";
-        cout << "         PARTY PERFORMANCE BY REGION\n";
-        cout << string(80, '=') << "\n";
-        
-        for (const auto& regionPair : regionPartyVotes) {
-            cout << "\nRegion: " << regionPair.first << "\n";
-            cout << string(60, '-') << "\n";
-            
-            vector<pair<string, int>> partyVotes(
-                regionPair.second.begin(), regionPair.second.end()
-            );
-            
-            sort(partyVotes.begin(), partyVotes.end(),
-                 [](const pair<string, int>& a, const pair<string, int>& b) {
-                     return a.second > b.second;
-                 });
-            
-            for (const auto& party : partyVotes) {
-                cout << "  " << left << setw(30) << party.first 
-                     << ": " << party.second << " votes\n";
-            }
-        }
-        cout << string(80, '=') << "\n";
+    void analyzePartyByRegion() { analyzePartyByRegion(db->createView()); }
+    
+    // The view carries the region x party matrix and each region's
+    // party order, so this only renders
+    void analyzePartyByRegion(const ElectionView& view) {
+        printPartyByRegion(view);
     }
     
     // Find swing regions (close races)
-    void findSwingRegions() {
-        map<string, vector<int>> regionVotes;
-        
-        for (const auto& candidate : db->getAllCandidates()) {
-            regionVotes[candidate.region].push_back(candidate.votes);
-        }
-        
+    void findSwingRegions() { findSwingRegions(db->createView()); }
+    
+    void findSwingRegions(const ElectionView& view) {
         cout << "\n" << string(70, '=') << "\n";
         cout << "           SWING REGION ANALYSIS\n";
         cout << string(70, '=') << "\n";
         cout << "Regions with close races (vote difference < 20%):\n\n";
         
-        for (auto& pair : regionVotes) {
-            if (pair.second.size() < 2) continue;
-            
-            sort(pair.second.begin(), pair.second.end(), greater<int>());
-            
-            int first = pair.second[0];
-            int second = pair.second[1];
-            int total = 0;
-            for (int v : pair.second) total += v;
+        // Top two per region come with the view, no per-region sort
+        const auto& regionVotes = view.stats.regionWiseVotes;
+        for (size_t r = 0; r < view.regionRaces.size(); r++) {
+            const RegionRace& race = view.regionRaces[r];
+            if (!race.contested() || r >= regionVotes.size()) continue;
             
+            int total = regionVotes[r];
             if (total > 0) {
-                double diff = abs(first - second) * 100.0 / total;
+                double diff = race.margin() * 100.0 / total;
                 if (diff < 20.0) {
-                    cout << "  " << left << setw(20) << pair.first
+                    cout << "  " << left << setw(20) << RegionName::fromId(r)
                          << " - Difference: " << fixed << setprecision(2) 
                          << diff << "%\n";
                 }
@@ -138,21 +98,25 @@ public:
     }
     
     // Voter turnout trends
-    void analyzeTurnoutTrends() {
-        const auto& regions = db->getAllRegions();
+    void analyzeTurnoutTrends() { analyzeTurnoutTrends(db->createView()); }
+    
+    void analyzeTurnoutTrends(const ElectionView& view) {
+        const auto& regions = view.regions;
         
-        if (regions.empty()) {
+        if (view.registeredRegions == 0) {
             cout << "\nNo regions data available.\n";
             return;
         }
         
-        vector<pair<string, double>> turnouts;
-        for (const auto& pair : regions) {
-            turnouts.push_back({pair.first, pair.second.getTurnout()});
+        vector<pair<RegionName, double>> turnouts;
+        for (const auto& region : regions) {
+            if (region.isRegistered()) {
+                turnouts.push_back({region.name, region.getTurnout()});
+            }
         }
         
         sort(turnouts.begin(), turnouts.end(),
-             [](const pair<string, double>& a, const pair<string, double>& b) {
+             [](const pair<RegionName, double>& a, const pair<RegionName, double>& b) {
                  return a.second > b.second;
              });
         
@@ -183,63 +147,14 @@ public:
     }
     
     // Predict winner based on current trends
-    void predictWinner() {
-        const auto& candidates = db->getAllCandidates();
-        
-        if (candidates.empty()) {
-            cout << "\nNo candidates available.\n";
-            return;
-        }
-        
+    void predictWinner() { predictWinner(db->createView()); }
+    
+    void predictWinner(const ElectionView& view) {
         int totalVotes = 0;
-        for (const auto& c : candidates) {
+        for (const auto& c : view.candidates) {
             totalVotes += c.votes;
         }
-        
-        if (totalVotes == 0) {
-            cout << "\nNo votes cast yet. Cannot predict winner.\n";
-            return;
-        }
-        
-        vector<Candidate> sorted = candidates;
-        sort(sorted.begin(), sorted.end(),
-             [](const Candidate& a, const Candidate& b) {
-                 return a.votes > b.votes;
-             });
-        
-        cout << "\n" << string(70, '=') << "\n";
-        cout << "           WINNER PREDICTION\n";
-        cout << string(70, '=') << "\n";
-        
-        if (sorted.size() > 0) {
-            double winPercentage = (totalVotes > 0) ? 
-                (sorted[0].votes * 100.0 / totalVotes) : 0.0;
-            
-            cout << "Current Leader: " << sorted[0].name << "\n";
-            cout << "Party: " << sorted[0].party << "\n";
-            cout << "Votes: " << sorted[0].votes << " (" 
-                 << fixed << setprecision(2) << winPercentage << "%)\n\n";
-            
-            if (sorted.size() > 1) {
-                double runnerUpPercentage = (totalVotes > 0) ? 
-                    (sorted[1].votes * 100.0 / totalVotes) : 0.0;
-                cout << "Runner-up: " << sorted[1].name << "\n";
-                cout << "Votes: " << sorted[1].votes << " (" 
-                     << runnerUpPercentage << "%)\n\n";
-                
-                double margin = winPercentage - runnerUpPercentage;
-                cout << "Lead Margin: " << margin << "%\n\n";
-                
-                if (margin > 10) {
-                    cout << "Prediction: Strong lead. Likely winner.\n";
-                } else if (margin > 5) {
-                    cout << "Prediction: Moderate lead. Competitive race.\n";
-                } else {
-                    cout << "Prediction: Very close race. Too close to call.\n";
-                }
-            }
-        }
-        cout << string(70, '=') << "\n";
+        printPrediction(view, totalVotes, projectionTrials);
     }
     
     // Generate comprehensive report
@@ -248,57 +163,230 @@ public:
         cout << "              COMPREHENSIVE ELECTION REPORT\n";
         cout << string(80, '=') << "\n";
         
-        ElectionStats stats = db->getStatistics();
-        stats.display();
+        // One view, one pass over voters and one over candidates; the
+        // sections below only render what was gathered
+        ElectionView view = db->createView();
+        ReportAggregates totals = aggregate(view, ageEdges);
+        view.stats.display();
         
         cout << "\n";
-        analyzeTurnoutTrends();
+        analyzeTurnoutTrends(view);
         
         cout << "\n";
-        analyzeByAgeGroup();
+        printAgeGroups(totals);
         
         cout << "\n";
-        analyzePartyByRegion();
+        printPartyByRegion(view);
         
         cout << "\n";
-        findSwingRegions();
+        findSwingRegions(view);
         
         cout << "\n";
-        predictWinner();
+        printPrediction(view, totals.totalVotes, projectionTrials);
     }
     
     // Identify inactive voters
-    void findInactiveVoters() {
-        vector<Voter> inactive;
-        
-        for (const auto& voter : db->getAllVoters()) {
-            if (!voter.hasVoted) {
-                inactive.push_back(voter);
-            }
-        }
+    void findInactiveVoters() { findInactiveVoters(db->createView()); }
+    
+    void findInactiveVoters(const ElectionView& view) {
+        const VoterTable& voters = *view.voters;
+        size_t inactive = view.voterCount() - view.voted.count();
         
         cout << "\n" << string(70, '=') << "\n";
         cout << "           INACTIVE VOTERS\n";
         cout << string(70, '=') << "\n";
-        cout << "Total Inactive Voters: " << inactive.size() << "\n";
+        cout << "Total Inactive Voters: " << inactive << "\n";
         
-        if (!inactive.empty()) {
+        if (inactive > 0) {
             cout << "\nSample of inactive voters:\n";
             cout << string(70, '-') << "\n";
             
-            int displayCount = min(10, (int)inactive.size());
-            for (int i = 0; i < displayCount; i++) {
-                cout << "  ID: " << inactive[i].id 
-                     << " | Name: " << inactive[i].name
-                     << " | Region: " << inactive[i].region << "\n";
+            // Walk the clear bits of the voted bitmap
+            size_t shown = 0;
+            for (size_t slot = view.voted.nextClear(0); 
+                 slot < view.voterCount() && shown < 10;
+                 slot = view.voted.nextClear(slot + 1), shown++) {
+                cout << "  ID: " << voters.ids[slot] 
+                     << " | Name: " << voters.name(slot)
+                     << " | Region: " << voters.region(slot) << "\n";
+            }
+            
+            if (inactive > 10) {
+                cout << "... and " << (inactive - 10) << " more\n";
+            }
+        }
+        cout << string(70, '=') << "\n";
+    }
+    
+    // Both passes the comprehensive report needs
+    static ReportAggregates aggregate(const ElectionView& view,
+                                      const vector<int>& ageEdges = AgeHistogram::standardEdges()) {
+        ReportAggregates totals(ageEdges);
+        tallyVoters(view, totals);
+        tallyCandidates(view, totals);
+        return totals;
+    }
+    
+    // Voter pass: the age histogram (see histogram.h), over the age
+    // column and the voted bitmap only
+    static void tallyVoters(const ElectionView& view, ReportAggregates& totals) {
+        totals.ages.count(view.voters->ages.data(), view.voted);
+    }
+    
+    // Candidate pass: the overall vote total (the region x party
+    // breakdown is maintained by the database and comes with the view)
+    static void tallyCandidates(const ElectionView& view, ReportAggregates& totals) {
+        totals.totalVotes = 0;
+        for (const auto& candidate : view.candidates) {
+            totals.totalVotes += candidate.votes;
+        }
+    }
+
+private:
+    static void printAgeGroups(const ReportAggregates& totals) {
+        const AgeHistogram& ages = totals.ages;
+        
+        cout << "\n" << string(70, '=') << "\n";
+        cout << "           AGE GROUP VOTING ANALYSIS\n";
+        cout << string(70, '=') << "\n";
+        cout << left << setw(15) << "Age Group"
+             << setw(20) << "Total Voters"
+             << setw(20) << "Voted"
+             << setw(15) << "Turnout" << "\n";
+        cout << string(70, '=') << "\n";
+        
+        for (size_t b = 0; b < ages.binCount(); b++) {
+            // Below the first bracket is only shown when someone is there
+            if (b == 0 && ages.binCount() > 1 && ages.total(0) == 0) continue;
+            
+            cout << left << setw(15) << ages.label(b)
+                 << setw(20) << ages.total(b)
+                 << setw(20) << ages.votedIn(b)
+                 << fixed << setprecision(2)
+                 << ages.turnout(b) << "%\n";
+        }
+        cout << string(70, '=') << "\n";
+    }
+    
+    static void printPartyByRegion(const ElectionView& view) {
+        cout << "\n" << string(80, '=') << "\n";
+        cout << "         PARTY PERFORMANCE BY REGION\n";
+        cout << string(80, '=') << "\n";
+        
+        for (size_t r = 0; r < view.partyOrder.size(); r++) {
+            if (view.partyOrder[r].empty()) continue;
+            
+            cout << "\nRegion: " << RegionName::fromId(r) << "\n";
+            cout << string(60, '-') << "\n";
+            
+            for (int party : view.partyOrder[r]) {
+                cout << "  " << left << setw(30) << PartyName::fromId(party) 
+                     << ": " << view.partyVotesIn(r, party) << " votes\n";
             }
+        }
+        cout << string(80, '=') << "\n";
+    }
+    
+    static void printPrediction(const ElectionView& view, int totalVotes, size_t trials) {
+        const auto& candidates = view.candidates;
+        
+        if (candidates.empty()) {
+            cout << "\nNo candidates available.\n";
+            return;
+        }
+        
+        if (totalVotes == 0) {
+            cout << "\nNo votes cast yet. Cannot predict winner.\n";
+            return;
+        }
+        
+        // Top two from the view's ranking, no sort
+        const Candidate& leader = candidates[view.ranking[0]];
+        
+        cout << "\n" << string(70, '=') << "\n";
+        cout << "           WINNER PREDICTION\n";
+        cout << string(70, '=') << "\n";
+        
+        double winPercentage = (totalVotes > 0) ? 
+            (leader.votes * 100.0 / totalVotes) : 0.0;
+        
+        cout << "Current Leader: " << leader.name << "\n";
+        cout << "Party: " << leader.party << "\n";
+        cout << "Votes: " << leader.votes << " (" 
+             << fixed << setprecision(2) << winPercentage << "%)\n\n";
+        
+        if (candidates.size() > 1) {
+            const Candidate& runnerUp = candidates[view.ranking[1]];
+            double runnerUpPercentage = (totalVotes > 0) ? 
+                (runnerUp.votes * 100.0 / totalVotes) : 0.0;
+            cout << "Runner-up: " << runnerUp.name << "\n";
+            cout << "Votes: " << runnerUp.votes << " (" 
+                 << runnerUpPercentage << "%)\n\n";
+            
+            double margin = winPercentage - runnerUpPercentage;
+            cout << "Lead Margin: " << margin << "%\n\n";
             
-            if (inactive.size() > 10) {
-                cout << "... and " << (inactive.size() - 10) << " more\n";
+            if (margin > 10) {
+                cout << "Prediction: Strong lead. Likely winner.\n";
+            } else if (margin > 5) {
+                cout << "Prediction: Moderate lead. Competitive race.\n";
+            } else {
+                cout << "Prediction: Very close race. Too close to call.\n";
             }
         }
+        
+        if (trials > 0) {
+            printProjection(view, trials);
+        }
         cout << string(70, '=') << "\n";
     }
+    
+    // Win chances if every voter who has not voted yet votes like their
+    // region has so far (see projection.h)
+    static void printProjection(const ElectionView& view, size_t trials) {
+        auto start = chrono::steady_clock::now();
+        ProjectionResult projection = OutcomeProjection::run(view, trials);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        
+        cout << "\nProjection (" << trials << " simulated completions, " 
+             << fixed << setprecision(0) << ms << " ms):\n";
+        cout << left << setw(25) << "Candidate"
+             << setw(20) << "Win Chance"
+             << "Projected Votes (95%)\n";
+        cout << string(70, '-') << "\n";
+        
+        vector<int> order;
+        for (size_t i = 0; i < view.candidates.size(); i++) {
+            if (projection.candidateWins[i] > 0) order.push_back(i);
+        }
+        sort(order.begin(), order.end(), [&](int a, int b) {
+            return projection.candidateWins[a] > projection.candidateWins[b];
+        });
+        if (order.size() > 10) order.resize(10);
+        
+        for (int i : order) {
+            double p = projection.candidateWins[i];
+            double mean = projection.candidateMeanVotes[i];
+            double spread = 1.96 * projection.candidateVotesSpread[i];
+            ostringstream chance, votes;
+            chance << fixed << setprecision(2) << p * 100 << "% +/- " 
+                   << projection.winInterval(p) * 100;
+            votes << fixed << setprecision(0) << max(0.0, mean - spread) 
+                  << " - " << mean + spread;
+            cout << left << setw(25) << view.candidates[i].name
+                 << setw(20) << chance.str() << votes.str() << "\n";
+        }
+        
+        cout << "\n" << left << setw(25) << "Party" << "Win Chance\n";
+        cout << string(70, '-') << "\n";
+        for (size_t p = 0; p < projection.partyWins.size(); p++) {
+            double chance = projection.partyWins[p];
+            if (chance <= 0) continue;
+            cout << left << setw(25) << PartyName::fromId(p)
+                 << fixed << setprecision(2) << chance * 100 << "% +/- " 
+                 << projection.winInterval(chance) * 100 << "\n";
+        }
+    }
 };
 
 #endif // ANALYTICS_H
@@ -0,0 +1,128 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+// Dense bit set, 64 bits per word. Used for per-voter flags keyed by
+// voter slot, so counting is a popcount per word and finding the clear
+// bits skips 64 voters at a time.
+class Bitmap {
+private:
+    vector<uint64_t> words;
+    size_t bits;
+    
+    static int popcount(uint64_t w) {
+#ifdef _MSC_VER
+        return (int)__popcnt64(w);
+#else
+        return __builtin_popcountll(w);
+#endif
+    }
+    
+    uint64_t loadWord(size_t w) const {
+#ifdef _MSC_VER
+        return *(const volatile uint64_t*)&words[w];
+#else
+        return __atomic_load_n(&words[w], __ATOMIC_ACQUIRE);
+#endif
+    }
+    
+    static int lowestBit(uint64_t w) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, w);
+        return (int)index;
+#else
+        return __builtin_ctzll(w);
+#endif
+    }
+
+public:
+    Bitmap() : bits(0) {}
+    explicit Bitmap(size_t n) : words((n + 63) / 64, 0), bits(n) {}
+    
+    size_t size() const { return bits; }
+    
+    void reserve(size_t n) { words.reserve((n + 63) / 64); }
+    
+    void push_back(bool value) {
+        if (bits % 64 == 0) words.push_back(0);
+        if (value) words[bits / 64] |= uint64_t(1) << (bits % 64);
+        bits++;
+    }
+    
+    bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+    void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(size_t i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+    
+    // Atomic variants, for threads that set different bits which may share
+    // a word. setAtomic returns the bit's previous value.
+    bool testAtomic(size_t i) const {
+        return (loadWord(i / 64) >> (i % 64)) & 1;
+    }
+    
+    bool setAtomic(size_t i) {
+        uint64_t bit = uint64_t(1) << (i % 64);
+#ifdef _MSC_VER
+        uint64_t old = _InterlockedOr64((volatile __int64*)&words[i / 64], (__int64)bit);
+#else
+        uint64_t old = __atomic_fetch_or(&words[i / 64], bit, __ATOMIC_ACQ_REL);
+#endif
+        return (old & bit) != 0;
+    }
+    
+    // Number of set bits
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t w : words) total += popcount(w);
+        return total;
+    }
+    
+    // Number of bits set in both this and mask (same size)
+    size_t countAnd(const Bitmap& mask) const {
+        size_t total = 0;
+        for (size_t i = 0; i < words.size(); i++) {
+            total += popcount(words[i] & mask.words[i]);
+        }
+        return total;
+    }
+    
+    // countAnd while other threads may setAtomic bits of this bitmap
+    size_t countAndAtomic(const Bitmap& mask) const {
+        size_t total = 0;
+        for (size_t i = 0; i < words.size(); i++) {
+            total += popcount(loadWord(i) & mask.words[i]);
+        }
+        return total;
+    }
+    
+    // First clear bit at or after i, or size() if there is none
+    size_t nextClear(size_t i) const {
+        if (i >= bits) return bits;
+        size_t w = i / 64;
+        uint64_t clear = ~words[w] & (~uint64_t(0) << (i % 64));
+        while (clear == 0) {
+            if (++w == words.size()) return bits;
+            clear = ~words[w];
+        }
+        size_t found = w * 64 + lowestBit(clear);
+        return (found < bits) ? found : bits;
+    }
+    
+    const vector<uint64_t>& data() const { return words; }
+    
+    // Adopt raw words (e.g. from a snapshot); bits past n must be clear
+    void assign(vector<uint64_t>&& w, size_t n) {
+        words = move(w);
+        bits = n;
+    }
+};
+
+#endif // BITMAP_H
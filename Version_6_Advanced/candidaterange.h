@@ -0,0 +1,141 @@
+#ifndef CANDIDATERANGE_H
+#define CANDIDATERANGE_H
+
+#include "election.h"
+#include <vector>
+#include <iterator>
+#include <cstddef>
+
+using namespace std;
+
+// Iterable view of the live candidates in ElectionDatabase's slot array,
+// in slot order, skipping deleted (tombstoned) slots. Copying it copies
+// three pointers, not the candidates; it stays valid until candidates
+// are next added, deleted or compacted.
+class CandidateRange {
+private:
+    const Candidate* rows;
+    const unsigned char* live;
+    size_t slots;
+    size_t liveCount;
+
+public:
+    class iterator {
+    private:
+        const Candidate* rows;
+        const unsigned char* live;
+        size_t slot;
+        size_t end;
+        
+        void skipDead() {
+            while (slot < end && !live[slot]) slot++;
+        }
+    
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef Candidate value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Candidate* pointer;
+        typedef const Candidate& reference;
+        
+        iterator(const Candidate* r, const unsigned char* l, size_t s, size_t e)
+            : rows(r), live(l), slot(s), end(e) { skipDead(); }
+        
+        const Candidate& operator*() const { return rows[slot]; }
+        const Candidate* operator->() const { return &rows[slot]; }
+        
+        iterator& operator++() {
+            slot++;
+            skipDead();
+            return *this;
+        }
+        
+        iterator operator++(int) {
+            iterator before = *this;
+            ++*this;
+            return before;
+        }
+        
+        bool operator==(const iterator& other) const { return slot == other.slot; }
+        bool operator!=(const iterator& other) const { return slot != other.slot; }
+        
+        // Slot of the current candidate in the database
+        size_t slotIndex() const { return slot; }
+    };
+    
+    CandidateRange(const Candidate* r, const unsigned char* l, size_t n, size_t count)
+        : rows(r), live(l), slots(n), liveCount(count) {}
+    
+    iterator begin() const { return iterator(rows, live, 0, slots); }
+    iterator end() const { return iterator(rows, live, slots, slots); }
+    
+    size_t size() const { return liveCount; }
+    bool empty() const { return liveCount == 0; }
+    
+    vector<Candidate> toVector() const {
+        return vector<Candidate>(begin(), end());
+    }
+};
+
+// Candidates at a list of slots (one region's or one party's), read in
+// place from the database: no copies, no allocation. Same lifetime as
+// CandidateRange.
+class CandidateSlice {
+private:
+    const Candidate* rows;
+    const int* slots;
+    size_t count;
+
+public:
+    class iterator {
+    private:
+        const Candidate* rows;
+        const int* slot;
+    
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef Candidate value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Candidate* pointer;
+        typedef const Candidate& reference;
+        
+        iterator(const Candidate* r, const int* s) : rows(r), slot(s) {}
+        
+        const Candidate& operator*() const { return rows[*slot]; }
+        const Candidate* operator->() const { return &rows[*slot]; }
+        
+        iterator& operator++() {
+            slot++;
+            return *this;
+        }
+        
+        iterator operator++(int) {
+            iterator before = *this;
+            slot++;
+            return before;
+        }
+        
+        bool operator==(const iterator& other) const { return slot == other.slot; }
+        bool operator!=(const iterator& other) const { return slot != other.slot; }
+        
+        // Slot of the current candidate in the database
+        size_t slotIndex() const { return *slot; }
+    };
+    
+    CandidateSlice() : rows(nullptr), slots(nullptr), count(0) {}
+    CandidateSlice(const Candidate* r, const int* s, size_t n)
+        : rows(r), slots(s), count(n) {}
+    
+    iterator begin() const { return iterator(rows, slots); }
+    iterator end() const { return iterator(rows, slots + count); }
+    
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Candidate& operator[](size_t i) const { return rows[slots[i]]; }
+    
+    vector<Candidate> toVector() const {
+        return vector<Candidate>(begin(), end());
+    }
+};
+
+#endif // CANDIDATERANGE_H
@@ -0,0 +1,185 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <cstddef>
+#include <memory>
+
+using namespace std;
+
+// Small per-thread number (0, 1, 2, ... in order of first use), for
+// picking a stripe
+inline size_t currentThreadStripe() {
+    static atomic<size_t> nextThread(0);
+    thread_local size_t mine = nextThread.fetch_add(1);
+    return mine;
+}
+
+// One stripe per hardware thread (capped at 16)
+inline size_t defaultStripeCount() {
+    size_t n = thread::hardware_concurrency();
+    return (n == 0) ? 1 : (n > 16 ? 16 : n);
+}
+
+// Array of int counters that many threads can bump without locks.
+//
+// Each counter is split into stripes and every stripe sits on its own
+// cache line. A thread always adds to the same stripe (threads are dealt
+// stripes round-robin), so with enough stripes concurrent increments -
+// even of the same counter - never contend for a line. Reading a counter
+// sums its stripes, which is cheap for the small arrays (candidates,
+// parties, regions) this is used for.
+//
+// add() and get() are thread-safe. Changing the shape (push_back, erase,
+// resize, set, clear) is not, and must not overlap with them.
+class VoteCounters {
+private:
+    struct alignas(64) Cell {
+        atomic<int> value;
+        
+        Cell() : value(0) {}
+        Cell(const Cell& other) : value(other.value.load(memory_order_relaxed)) {}
+        Cell& operator=(const Cell& other) {
+            value.store(other.value.load(memory_order_relaxed), memory_order_relaxed);
+            return *this;
+        }
+    };
+    
+    vector<Cell> cells;     // counter i, stripe s at cells[i * stripes + s]
+    size_t stripes;
+
+public:
+    explicit VoteCounters(size_t stripeCount = defaultStripeCount())
+        : stripes(stripeCount > 0 ? stripeCount : 1) {}
+    
+    size_t size() const { return cells.size() / stripes; }
+    size_t stripeCount() const { return stripes; }
+    
+    void add(size_t i, int delta = 1) {
+        size_t s = (stripes == 1) ? 0 : currentThreadStripe() % stripes;
+        cells[i * stripes + s].value.fetch_add(delta, memory_order_relaxed);
+    }
+    
+    int get(size_t i) const {
+        int total = 0;
+        const Cell* c = &cells[i * stripes];
+        for (size_t s = 0; s < stripes; s++) {
+            total += c[s].value.load(memory_order_relaxed);
+        }
+        return total;
+    }
+    
+    void set(size_t i, int value) {
+        for (size_t s = 0; s < stripes; s++) {
+            cells[i * stripes + s].value.store(s == 0 ? value : 0, memory_order_relaxed);
+        }
+    }
+    
+    void push_back(int initial) {
+        cells.resize(cells.size() + stripes);
+        set(size() - 1, initial);
+    }
+    
+    void erase(size_t i) {
+        cells.erase(cells.begin() + i * stripes, cells.begin() + (i + 1) * stripes);
+    }
+    
+    // New counters start at zero
+    void resize(size_t n) { cells.resize(n * stripes); }
+    void reserve(size_t n) { cells.reserve(n * stripes); }
+    void clear() { cells.clear(); }
+};
+
+// Array of plain atomic int counters, 4 bytes each. For large tables
+// (the region x party matrix), where a cache line per counter and stripe
+// would cost more than the contention it saves. Thread-safety as for
+// VoteCounters.
+class DenseCounters {
+private:
+    unique_ptr<atomic<int>[]> cells;
+    size_t count;
+
+public:
+    DenseCounters() : count(0) {}
+    
+    size_t size() const { return count; }
+    
+    void add(size_t i, int delta = 1) { cells[i].fetch_add(delta, memory_order_relaxed); }
+    int get(size_t i) const { return cells[i].load(memory_order_relaxed); }
+    void set(size_t i, int value) { cells[i].store(value, memory_order_relaxed); }
+    
+    // New counters start at zero
+    void resize(size_t n) {
+        unique_ptr<atomic<int>[]> grown(new atomic<int>[n]);
+        for (size_t i = 0; i < n; i++) {
+            grown[i].store(i < count ? get(i) : 0, memory_order_relaxed);
+        }
+        cells = move(grown);
+        count = n;
+    }
+    
+    void clear() {
+        cells.reset();
+        count = 0;
+    }
+};
+
+// Lets one thread briefly stop writers to take a consistent copy of
+// what they write, without writers ever taking a lock.
+//
+// Writers bracket each update with enter()/exit(), which only bump a
+// per-stripe in-flight count. exclusive(f) closes the gate, waits for
+// the in-flight updates to finish, runs f while no update can start, and
+// reopens the gate; writers arriving meanwhile wait for it (f should be
+// a short copy, not the analysis itself).
+class WriteGate {
+private:
+    struct alignas(64) Slot {
+        atomic<int> active;
+        
+        Slot() : active(0) {}
+    };
+    
+    vector<Slot> slots;
+    atomic<bool> closed;
+    mutex exclusiveLock;
+
+public:
+    explicit WriteGate(size_t stripeCount = defaultStripeCount())
+        : slots(stripeCount > 0 ? stripeCount : 1), closed(false) {}
+    
+    // Returns the slot to pass to exit()
+    size_t enter() {
+        size_t s = currentThreadStripe() % slots.size();
+        while (true) {
+            slots[s].active.fetch_add(1, memory_order_seq_cst);
+            if (!closed.load(memory_order_seq_cst)) {
+                return s;
+            }
+            slots[s].active.fetch_sub(1, memory_order_release);
+            while (closed.load(memory_order_acquire)) {
+                this_thread::yield();
+            }
+        }
+    }
+    
+    void exit(size_t s) { slots[s].active.fetch_sub(1, memory_order_release); }
+    
+    template <typename F>
+    void exclusive(F f) {
+        lock_guard<mutex> guard(exclusiveLock);
+        closed.store(true, memory_order_seq_cst);
+        for (auto& slot : slots) {
+            while (slot.active.load(memory_order_acquire) != 0) {
+                this_thread::yield();
+            }
+        }
+        f();
+        closed.store(false, memory_order_release);
+    }
+};
+
+#endif // COUNTERS_H
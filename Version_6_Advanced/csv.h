@@ -0,0 +1,140 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <charconv>
+
+using namespace std;
+
+// Streaming CSV reader over an in-memory buffer.
+//
+// Fields come back as string_views into the buffer, so a row costs no
+// allocations once the field vector has grown to the row width. Quoted
+// fields may contain commas and doubled quotes (""); the quotes are
+// unescaped in place, which is why the reader needs a writable buffer.
+// Records end at '\n' (a trailing '\r' is dropped); quoted fields may
+// not span lines.
+class CsvReader {
+private:
+    char* pos;
+    char* end;
+    int line;
+
+public:
+    CsvReader(char* begin, char* finish, int firstLine = 1)
+        : pos(begin), end(finish), line(firstLine - 1) {}
+    
+    // Read a whole file into buffer
+    static bool readFile(const string& filename, vector<char>& buffer) {
+        ifstream file(filename, ios::binary | ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+        
+        streamsize size = file.tellg();
+        file.seekg(0, ios::beg);
+        buffer.resize(size);
+        return size == 0 || (bool)file.read(buffer.data(), size);
+    }
+    
+    // Split the next non-empty record into fields. Returns false at end of input.
+    bool next(vector<string_view>& fields) {
+        while (pos < end) {
+            line++;
+            fields.clear();
+            
+            char* lineEnd = pos;
+            while (lineEnd < end && *lineEnd != '\n') lineEnd++;
+            char* stop = (lineEnd > pos && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+            
+            char* p = pos;
+            pos = (lineEnd < end) ? lineEnd + 1 : end;
+            if (p == stop) continue;
+            
+            while (true) {
+                if (p < stop && *p == '"') {
+                    // Quoted field: compact "" -> " in place
+                    char* out = ++p;
+                    char* start = out;
+                    while (p < stop) {
+                        if (*p == '"') {
+                            if (p + 1 < stop && p[1] == '"') {
+                                *out++ = '"';
+                                p += 2;
+                                continue;
+                            }
+                            p++;
+                            break;
+                        }
+                        *out++ = *p++;
+                    }
+                    fields.push_back(string_view(start, out - start));
+                    while (p < stop && *p != ',') p++;
+                } else {
+                    char* start = p;
+                    while (p < stop && *p != ',') p++;
+                    fields.push_back(string_view(start, p - start));
+                }
+                
+                if (p >= stop) break;
+                p++; // skip ','
+            }
+            return true;
+        }
+        return false;
+    }
+    
+    // Split [begin, finish) into at most `count` ranges that each start at
+    // the beginning of a line, for parsing on separate threads
+    static vector<pair<char*, char*>> splitLines(char* begin, char* finish, size_t count) {
+        vector<pair<char*, char*>> chunks;
+        size_t total = finish - begin;
+        char* start = begin;
+        
+        for (size_t i = 1; i <= count && start < finish; i++) {
+            char* cut = (i == count) ? finish : begin + total * i / count;
+            if (cut < start) cut = start;
+            while (cut < finish && cut > begin && cut[-1] != '\n') cut++;
+            if (cut > start) {
+                chunks.push_back(make_pair(start, cut));
+                start = cut;
+            }
+        }
+        return chunks;
+    }
+    
+    // Line number of the record last returned by next()
+    int lineNumber() const { return line; }
+    
+    // Strict integer parse: the whole field must be a number
+    static bool parseInt(string_view field, int& out) {
+        while (!field.empty() && field.front() == ' ') field.remove_prefix(1);
+        while (!field.empty() && field.back() == ' ') field.remove_suffix(1);
+        if (field.empty()) return false;
+        
+        const char* first = field.data();
+        if (*first == '+') first++;
+        auto result = from_chars(first, field.data() + field.size(), out);
+        return result.ec == errc() && result.ptr == field.data() + field.size();
+    }
+    
+    // Quote a field for writing if it contains a separator or quote
+    static string escape(string_view field) {
+        if (field.find_first_of(",\"") == string_view::npos) {
+            return string(field);
+        }
+        
+        string quoted = "\"";
+        for (char ch : field) {
+            if (ch == '"') quoted += '"';
+            quoted += ch;
+        }
+        quoted += '"';
+        return quoted;
+    }
+};
+
+#endif // CSV_H
@@ -2,149 +2,837 @@
 #define DATABASE_H
 
 #include "election.h"
+#include "votertable.h"
+#include "journal.h"
+#include "idindex.h"
+#include "counters.h"
+#include "view.h"
+#include "candidaterange.h"
 #include <vector>
+#include <mutex>
 #include <map>
 #include <algorithm>
+#include <optional>
+#include <memory>
 #include <fstream>
 #include <sstream>
 
 using namespace std;
 
+// castVote is lock-free and may be called from many threads at once;
+// everything else that mutates (adding/deleting rows, bulk loads,
+// snapshot loads, journal replay) must not run concurrently with it.
 class ElectionDatabase {
 private:
-    vector<Candidate> candidates;
-    vector<Voter> voters;
-    map<string, Region> regions;
+    // mutable only so const readers can refresh the votes/votesPolled
+    // fields from the live counters, see syncVotes()
+    mutable vector<Candidate> candidates;
     
-public:
-    // Candidate Management
-    bool addCandidate(const Candidate& candidate) {
-        // Check if ID already exists
+    // Columnar, see votertable.h. Shared with views, which read the
+    // columns castVote never writes; adding rows detaches it first.
+    shared_ptr<VoterTable> voters;
+    mutable vector<Region> regions;     // dense, indexed by RegionName id
+    int registeredRegions;
+    
+    // Primary key indexes (flat hash tables): id -> slot in the vectors above.
+    // Slots (unlike Candidate*/Voter*) stay valid across push_back
+    // reallocation.
+    IdIndex candidateIndex;
+    IdIndex voterIndex;
+    
+    // Candidate slots never shift: a delete tombstones its slot for the
+    // next add to reuse; only compactCandidates() renumbers
+    vector<unsigned char> candidateLive;    // by slot
+    vector<int> freeCandidateSlots;
+    int liveCandidates;
+    
+    // Secondary indexes: RegionName / PartyName id -> live candidate slots;
+    // positions (by slot) let a delete swap-remove in O(1)
+    vector<vector<int>> regionSlots, partySlots;
+    vector<int> regionPosition, partyPosition;  // by slot
+    
+    // Live vote counts, bumped lock-free by castVote (see counters.h);
+    // Candidate::votes and Region::votesPolled are copies (syncVotes)
+    VoteCounters candidateVotes;        // by candidate slot
+    VoteCounters regionPolled;          // by RegionName id
+    mutable mutex syncLock;
+    
+    // Live candidate slots by votes (ties by slot), repaired by an
+    // insertion-sort pass on each read, or re-sorted when too much moved;
+    // rankStale forces a full re-sort.
+    // Guarded by syncLock.
+    mutable vector<int> rankOrder;
+    mutable bool rankStale;
+    
+    // Winner and runner-up of every region (slots, by RegionName id), read
+    // off rankOrder in the same repair
+    mutable vector<RegionRace> regionRaces;
+    
+    // Every claim + tally runs inside the gate, so createView() can take
+    // a copy in which the voted bits and all the counters agree
+    mutable WriteGate writeGate;
+    
+    // Running tallies behind getStatistics(), kept current by every
+    // mutation so a read is O(parties + regions) instead of a rescan
+    VoteCounters votesCast;             // a single counter
+    VoteCounters partyVotes;            // by PartyName id
+    VoteCounters regionVotes;           // by RegionName id
+    vector<int> partyCandidates, regionCandidates;
+    
+    // Region x party votes (cell r * partyStride + p) and candidates per
+    // cell; plain atomics, the matrix is too large to stripe per cell
+    DenseCounters regionPartyVotes;
+    vector<int> regionPartyCandidates;
+    size_t partyStride;
+    vector<unsigned> regionPartyEpoch;  // by region: bumped when its candidate set changes
+    
+    // Per region: parties with candidates there, most votes first (see
+    // refreshPartyOrder). Guarded by syncLock.
+    mutable vector<vector<int>> partyOrder;
+    mutable vector<pair<int, unsigned>> partyOrderStamp;   // (row total, epoch) when sorted
+    
+    // Optional vote log that castVote appends to (not owned)
+    VoteJournal* journal;
+    
+    // Add (sign = 1) or remove (sign = -1) a candidate with the given
+    // vote count from the tallies
+    void tallyCandidate(const Candidate& c, int votes, int sign) {
+        if (c.party.id() >= (int)partyCandidates.size()) {
+            partyVotes.resize(c.party.id() + 1);
+            partyCandidates.resize(c.party.id() + 1, 0);
+        }
+        if (c.region.id() >= (int)regionCandidates.size()) {
+            regionVotes.resize(c.region.id() + 1);
+            regionCandidates.resize(c.region.id() + 1, 0);
+        }
+        
+        partyVotes.add(c.party.id(), sign * votes);
+        partyCandidates[c.party.id()] += sign;
+        regionVotes.add(c.region.id(), sign * votes);
+        regionCandidates[c.region.id()] += sign;
+        
+        size_t cell = regionPartyCell(c.region.id(), c.party.id());
+        regionPartyVotes.add(cell, sign * votes);
+        regionPartyCandidates[cell] += sign;
+        regionPartyEpoch[c.region.id()]++;
+    }
+    
+    // Before voter rows are added: a view may still hold the current
+    // table, so give the database its own copy
+    void detachVoters() {
+        if (voters.use_count() > 1) {
+            voters = make_shared<VoterTable>(*voters);
+        }
+    }
+    
+    // Matrix cell of (region, party), growing the matrix for new ids
+    size_t regionPartyCell(int r, int p) {
+        size_t rows = regionPartyEpoch.size();
+        if ((size_t)p >= partyStride) {
+            size_t stride = max<size_t>(partyStride, 4);
+            while (stride <= (size_t)p) stride *= 2;
+            
+            DenseCounters votes;
+            votes.resize(rows * stride);
+            vector<int> counts(rows * stride, 0);
+            for (size_t row = 0; row < rows; row++) {
+                for (size_t q = 0; q < partyStride; q++) {
+                    votes.set(row * stride + q, regionPartyVotes.get(row * partyStride + q));
+                    counts[row * stride + q] = regionPartyCandidates[row * partyStride + q];
+                }
+            }
+            regionPartyVotes = move(votes);
+            regionPartyCandidates = move(counts);
+            partyStride = stride;
+        }
+        if ((size_t)r >= rows) {
+            regionPartyEpoch.resize(r + 1, 0);
+            regionPartyVotes.resize((r + 1) * partyStride);
+            regionPartyCandidates.resize((r + 1) * partyStride, 0);
+        }
+        return r * partyStride + p;
+    }
+    
+    // Re-sort the partyOrder rows whose total or epoch changed, from a
+    // matrix copy with rows stride wide (syncLock held)
+    void refreshPartyOrder(const vector<int>& votes, size_t stride) const {
+        size_t rows = regionPartyEpoch.size();
+        partyOrder.resize(rows);
+        partyOrderStamp.resize(rows, make_pair(-1, 0u));
+        
+        for (size_t r = 0; r < rows; r++) {
+            const int* row = &votes[r * stride];
+            int total = 0;
+            for (size_t p = 0; p < stride; p++) total += row[p];
+            pair<int, unsigned> stamp(total, regionPartyEpoch[r]);
+            if (stamp == partyOrderStamp[r]) continue;
+            
+            vector<int>& order = partyOrder[r];
+            if (stamp.second != partyOrderStamp[r].second) {
+                order.clear();
+                for (size_t p = 0; p < stride; p++) {
+                    if (regionPartyCandidates[r * partyStride + p] > 0) order.push_back(p);
+                }
+            }
+            for (size_t i = 1; i < order.size(); i++) {
+                int party = order[i];
+                size_t j = i;
+                while (j > 0 && (row[party] > row[order[j - 1]] ||
+                                 (row[party] == row[order[j - 1]] && party < order[j - 1]))) {
+                    order[j] = order[j - 1];
+                    j--;
+                }
+                order[j] = party;
+            }
+            partyOrderStamp[r] = stamp;
+        }
+    }
+    
+    // Recompute every running tally from the stored rows (after a
+    // snapshot load replaced them wholesale)
+    void rebuildTallies() {
+        votesCast.set(0, voters->voted.count());
+        partyVotes.clear();
+        partyCandidates.clear();
+        regionPartyVotes.clear();
+        regionPartyCandidates.clear();
+        regionPartyEpoch.clear();
+        partyOrder.clear();
+        partyOrderStamp.clear();
+        regionVotes.clear();
+        regionCandidates.clear();
+        candidateVotes.clear();
+        candidateVotes.reserve(candidates.size());
         for (const auto& c : candidates) {
-            if (c.id == candidate.id) {
-                return false;
+            candidateVotes.push_back(c.votes);
+            tallyCandidate(c, c.votes, 1);
+        }
+        candidateLive.assign(candidates.size(), 1);
+        freeCandidateSlots.clear();
+        liveCandidates = candidates.size();
+        rankStale = true;
+        regionSlots.assign(regions.size(), vector<int>());
+        regionPosition.assign(candidates.size(), 0);
+        for (size_t r = 0; r < regions.size(); r++) {
+            for (int id : regions[r].candidateIds) {
+                linkSlot(regionSlots, r, candidateIndex.find(id), regionPosition);
             }
         }
+        partySlots.clear();
+        partyPosition.assign(candidates.size(), 0);
+        for (size_t i = 0; i < candidates.size(); i++) {
+            linkSlot(partySlots, candidates[i].party.id(), i, partyPosition);
+        }
         
-        candidates.push_back(candidate);
+        registeredRegions = 0;
+        regionPolled.clear();
+        regionPolled.resize(regions.size());
+        for (size_t r = 0; r < regions.size(); r++) {
+            if (regions[r].isRegistered()) registeredRegions++;
+            regionPolled.set(r, regions[r].votesPolled);
+        }
+    }
+    
+    // Per-thread castVotes scratch: accepted votes by candidate slot (zero
+    // between calls) and the slots that got any
+    struct TallyScratch {
+        vector<int> votes;
+        vector<int> touched;
+    };
+    
+    static TallyScratch& tallyScratch() {
+        thread_local TallyScratch scratch;
+        return scratch;
+    }
+    
+    // Check a vote and, if valid, claim the voter (of two racing claims
+    // only one wins). The caller tallies accepted votes.
+    VoteStatus claimVote(int voterSlot, int candidateSlot, time_t when) {
+        if (voters->voted.testAtomic(voterSlot)) {
+            return VoteStatus::AlreadyVoted;
+        }
+        if (voters->regionIds[voterSlot] != candidates[candidateSlot].region.id()) {
+            return VoteStatus::WrongRegion;
+        }
+        if (voters->voted.setAtomic(voterSlot)) {
+            return VoteStatus::AlreadyVoted;
+        }
+        VoterTable::storeShared(voters->voteTimes[voterSlot], when);
+        VoterTable::storeShared(voters->votedFor[voterSlot], candidates[candidateSlot].id);
+        return VoteStatus::Accepted;
+    }
+    
+    // Count n accepted votes for a candidate
+    void tallyVotes(int candidateSlot, int n) {
+        const Candidate& candidate = candidates[candidateSlot];
+        candidateVotes.add(candidateSlot, n);
+        regionPolled.add(candidate.region.id(), n);
+        votesCast.add(0, n);
+        partyVotes.add(candidate.party.id(), n);
+        regionVotes.add(candidate.region.id(), n);
+        regionPartyVotes.add(candidate.region.id() * partyStride + candidate.party.id(), n);
+    }
+    
+    // Append slot to lists[key], recording where it went
+    static void linkSlot(vector<vector<int>>& lists, int key, int slot, vector<int>& position) {
+        if (key >= (int)lists.size()) {
+            lists.resize(key + 1);
+        }
+        position[slot] = lists[key].size();
+        lists[key].push_back(slot);
+    }
+    
+    // Remove slot from lists[key] by moving the last entry into its place
+    static void unlinkSlot(vector<vector<int>>& lists, int key, int slot, vector<int>& position) {
+        vector<int>& list = lists[key];
+        int hole = position[slot];
+        list[hole] = list.back();
+        position[list[hole]] = hole;
+        list.pop_back();
+    }
+    
+    // Candidates at lists[key], with their votes refreshed
+    CandidateSlice sliceOf(const vector<vector<int>>& lists, int key) const {
+        if (key < 0 || key >= (int)lists.size() || lists[key].empty()) {
+            return CandidateSlice();
+        }
+        syncVotes(lists[key]);
+        return CandidateSlice(candidates.data(), lists[key].data(), lists[key].size());
+    }
+    
+    // Copy the live counters into the row records handed to readers
+    void syncVotes(const vector<int>& slots) const {
+        lock_guard<mutex> guard(syncLock);
+        for (int slot : slots) {
+            candidates[slot].votes = candidateVotes.get(slot);
+        }
+    }
+    
+    void syncVotes() const {
+        lock_guard<mutex> guard(syncLock);
+        syncVotesLocked();
+    }
+    
+    void syncVotesLocked() const {
+        for (size_t i = 0; i < candidates.size(); i++) {
+            candidates[i].votes = candidateVotes.get(i);
+        }
+        for (size_t r = 0; r < regions.size(); r++) {
+            regions[r].votesPolled = regionPolled.get(r);
+        }
+    }
+    
+    bool ranksBefore(int a, int b) const {
+        return candidates[a].votes > candidates[b].votes ||
+               (candidates[a].votes == candidates[b].votes && a < b);
+    }
+    
+    // Bring rankOrder up to date with the votes fields (syncLock held)
+    void repairRanking() const {
+        auto before = [this](int a, int b) { return ranksBefore(a, b); };
+        if (rankStale) {
+            rankOrder.clear();
+            for (size_t slot = 0; slot < candidates.size(); slot++) {
+                if (candidateLive[slot]) rankOrder.push_back(slot);
+            }
+            sort(rankOrder.begin(), rankOrder.end(), before);
+            rankStale = false;
+        } else {
+            // Insertion sort is quadratic once many ranks moved (a burst of
+            // votes); past n/16 displacements a full sort is cheaper
+            size_t budget = rankOrder.size() / 16;
+            size_t moves = 0;
+            for (size_t i = 1; i < rankOrder.size() && moves <= budget; i++) {
+                int slot = rankOrder[i];
+                size_t j = i;
+                while (j > 0 && before(slot, rankOrder[j - 1])) {
+                    rankOrder[j] = rankOrder[j - 1];
+                    j--;
+                }
+                rankOrder[j] = slot;
+                moves += i - j;
+            }
+            if (moves > budget) {
+                sort(rankOrder.begin(), rankOrder.end(), before);
+            }
+        }
         
-        // Update region
-        if (regions.find(candidate.region) == regions.end()) {
-            regions[candidate.region] = Region(candidate.region);
+        regionRaces.assign(regions.size(), RegionRace());
+        for (int slot : rankOrder) {
+            RegionRace& race = regionRaces[candidates[slot].region.id()];
+            if (race.winner < 0) {
+                race.winner = slot;
+                race.winnerVotes = candidates[slot].votes;
+            } else if (race.runnerUp < 0) {
+                race.runnerUp = slot;
+                race.runnerUpVotes = candidates[slot].votes;
+            }
+        }
+    }
+    
+    // Slot the next added candidate will occupy
+    int nextCandidateSlot() const {
+        return freeCandidateSlots.empty() ? (int)candidates.size() : freeCandidateSlots.back();
+    }
+    
+    // Put an already indexed candidate into slot (from nextCandidateSlot)
+    void storeCandidate(int slot, Candidate&& candidate) {
+        Region& region = regionFor(candidate.region);
+        if (slot == (int)candidates.size()) {
+            candidates.push_back(move(candidate));
+            candidateLive.push_back(1);
+            regionPosition.push_back(0);
+            partyPosition.push_back(0);
+            candidateVotes.push_back(candidates[slot].votes);
+        } else {
+            freeCandidateSlots.pop_back();
+            candidates[slot] = move(candidate);
+            candidateLive[slot] = 1;
+            candidateVotes.set(slot, candidates[slot].votes);
         }
-        regions[candidate.region].candidateIds.push_back(candidate.id);
         
-        return true;
+        region.candidateIds.push_back(candidates[slot].id);
+        linkSlot(regionSlots, region.name.id(), slot, regionPosition);
+        linkSlot(partySlots, candidates[slot].party.id(), slot, partyPosition);
+        tallyCandidate(candidates[slot], candidates[slot].votes, 1);
+        liveCandidates++;
+        rankStale = true;
     }
     
-    bool deleteCandidate(int id) {
-        for (auto it = candidates.begin(); it != candidates.end(); ++it) {
-            if (it->id == id) {
-                // Remove from region
-                auto& region = regions[it->region];
-                region.candidateIds.erase(
-                    remove(region.candidateIds.begin(), 
-                           region.candidateIds.end(), id),
-                    region.candidateIds.end()
-                );
-                
-                candidates.erase(it);
-                return true;
-            }
+    // Region slot for name, registering it on first use
+    Region& regionFor(const RegionName& name) {
+        if (name.id() >= (int)regions.size()) {
+            regions.resize(name.id() + 1);
+            regionPolled.resize(regions.size());
         }
-        return false;
+        Region& region = regions[name.id()];
+        if (!region.isRegistered()) {
+            region.name = name;
+            registeredRegions++;
+        }
+        return region;
     }
     
-    Candidate* findCandidate(int id) {
-        for (auto& c : candidates) {
-            if (c.id == id) {
-                return &c;
+    // What castVote changes, copied in one exclusive section so that a
+    // snapshot's voted bits, choices and tallies agree
+    struct VoteCheckpoint {
+        vector<Candidate> candidates;   // live rows
+        vector<Region> regions;
+        Bitmap voted;
+        vector<int> votedFor;
+        vector<time_t> voteTimes;
+        uint64_t journalSequence;       // every journaled vote up to it is included
+    };
+    
+    VoteCheckpoint checkpoint() const {
+        VoteCheckpoint state;
+        state.journalSequence = 0;
+        vector<int> candidateTotals(candidates.size());
+        vector<int> polled(regions.size());
+        
+        // A vote is journaled after its claim, so any record appended by
+        // now belongs to a vote the copy includes
+        writeGate.exclusive([&] {
+            for (size_t i = 0; i < candidateTotals.size(); i++) {
+                candidateTotals[i] = candidateVotes.get(i);
+            }
+            for (size_t r = 0; r < polled.size(); r++) {
+                polled[r] = regionPolled.get(r);
+            }
+            state.voted = voters->voted;
+            state.votedFor = voters->votedFor;
+            state.voteTimes = voters->voteTimes;
+            if (journal && journal->isOpen()) {
+                state.journalSequence = journal->getLastSequence();
             }
+        });
+        
+        lock_guard<mutex> guard(syncLock);
+        state.candidates.reserve(liveCandidates);
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (!candidateLive[i]) continue;
+            state.candidates.push_back(candidates[i]);
+            state.candidates.back().votes = candidateTotals[i];
+        }
+        state.regions = regions;
+        for (size_t r = 0; r < polled.size(); r++) {
+            state.regions[r].votesPolled = polled[r];
         }
-        return nullptr;
+        return state;
     }
     
-    vector<Candidate> getCandidatesByRegion(const string& region) {
-        vector<Candidate> result;
-        for (const auto& c : candidates) {
-            if (c.region == region) {
-                result.push_back(c);
+    friend class ElectionSnapshot;
+
+public:
+    ElectionDatabase() : voters(make_shared<VoterTable>()), registeredRegions(0), liveCandidates(0), 
+                         rankStale(true), partyStride(0), journal(nullptr) {
+        votesCast.push_back(0);
+    }
+    
+    // Candidate Management
+    bool addCandidate(const Candidate& candidate) {
+        // Check if ID already exists
+        int slot = nextCandidateSlot();
+        if (!candidateIndex.insert(candidate.id, slot)) {
+            return false;
+        }
+        
+        storeCandidate(slot, Candidate(candidate));
+        return true;
+    }
+    
+    // O(1): tombstones the slot instead of shifting the array
+    bool deleteCandidate(int id) {
+        int slot = findCandidateSlot(id);
+        if (slot < 0) {
+            return false;
+        }
+        
+        tallyCandidate(candidates[slot], candidateVotes.get(slot), -1);
+        
+        // Remove from region and party: move the last member into the hole
+        int regionId = candidates[slot].region.id();
+        vector<int>& members = regions[regionId].candidateIds;
+        members[regionPosition[slot]] = members.back();
+        members.pop_back();
+        unlinkSlot(regionSlots, regionId, slot, regionPosition);
+        unlinkSlot(partySlots, candidates[slot].party.id(), slot, partyPosition);
+        
+        candidateIndex.erase(id);
+        candidateLive[slot] = 0;
+        candidateVotes.set(slot, 0);
+        freeCandidateSlots.push_back(slot);
+        liveCandidates--;
+        rankStale = true;
+        return true;
+    }
+    
+    // Tombstoned slots waiting for an add or compactCandidates()
+    int getDeadCandidateSlots() const { return freeCandidateSlots.size(); }
+    
+    // Squeeze out tombstoned slots, keeping live order. Renumbers slots
+    // (and Candidate*, slices, ranges), so it is never called implicitly.
+    void compactCandidates() {
+        if (freeCandidateSlots.empty()) return;
+        
+        size_t next = 0;
+        for (size_t slot = 0; slot < candidates.size(); slot++) {
+            if (!candidateLive[slot]) continue;
+            if (slot != next) {
+                candidates[next] = move(candidates[slot]);
+                candidateVotes.set(next, candidateVotes.get(slot));
+                regionPosition[next] = regionPosition[slot];
+                partyPosition[next] = partyPosition[slot];
+                candidateIndex.update(candidates[next].id, next);
+                regionSlots[candidates[next].region.id()][regionPosition[next]] = next;
+                partySlots[candidates[next].party.id()][partyPosition[next]] = next;
             }
+            candidateLive[next] = 1;
+            next++;
         }
-        return result;
+        
+        candidates.erase(candidates.begin() + next, candidates.end());
+        candidateLive.resize(next);
+        regionPosition.resize(next);
+        partyPosition.resize(next);
+        candidateVotes.resize(next);
+        freeCandidateSlots.clear();
+        rankStale = true;
     }
     
-    vector<Candidate> getCandidatesByParty(const string& party) {
-        vector<Candidate> result;
-        for (const auto& c : candidates) {
-            if (c.party == party) {
-                result.push_back(c);
+    // Compact once dead slots outnumber live ones; for callers that hold
+    // no slots or Candidate* across the call. True if it compacted.
+    bool compactCandidatesIfSparse() {
+        if ((int)freeCandidateSlots.size() <= liveCandidates) return false;
+        compactCandidates();
+        return true;
+    }
+    
+    // Bulk counterpart of addCandidate, see addVotersBulk
+    BulkLoadReport addCandidatesBulk(vector<Candidate>&& rows,
+                                     const vector<int>& rowNumbers = vector<int>()) {
+        BulkLoadReport report;
+        candidates.reserve(liveCandidates + rows.size());
+        candidateIndex.reserve(liveCandidates + rows.size());
+        
+        for (size_t i = 0; i < rows.size(); i++) {
+            int row = rowNumbers.empty() ? (int)i + 1 : rowNumbers[i];
+            int slot = nextCandidateSlot();
+            if (!candidateIndex.insert(rows[i].id, slot)) {
+                report.rejected.push_back(RejectedRow(row, rows[i].id, "duplicate candidate ID"));
+                continue;
             }
+            storeCandidate(slot, move(rows[i]));
+            report.accepted++;
         }
-        return result;
+        
+        rows.clear();
+        return report;
+    }
+    
+    // Returns the slot of a candidate, or -1 if not registered
+    int findCandidateSlot(int id) const {
+        return candidateIndex.find(id);
+    }
+    
+    Candidate& candidateAt(int slot) {
+        lock_guard<mutex> guard(syncLock);
+        candidates[slot].votes = candidateVotes.get(slot);
+        return candidates[slot];
+    }
+    
+    Candidate* findCandidate(int id) {
+        int slot = findCandidateSlot(id);
+        return (slot >= 0) ? &candidateAt(slot) : nullptr;
+    }
+    
+    // O(matches) via the secondary indexes; the slice reads candidates in
+    // place. Pass typed names as RegionName::lookup(text) (not interned).
+    CandidateSlice getCandidatesByRegion(const RegionName& region) const {
+        return sliceOf(regionSlots, region.id());
+    }
+    
+    CandidateSlice getCandidatesByParty(const PartyName& party) const {
+        return sliceOf(partySlots, party.id());
     }
     
     // Voter Management
     bool addVoter(const Voter& voter) {
-        for (const auto& v : voters) {
-            if (v.id == voter.id) {
-                return false;
-            }
+        detachVoters();
+        if (!voterIndex.insert(voter.id, voters->size())) {
+            return false;
         }
         
-        voters.push_back(voter);
+        voters->append(voter);
+        if (voter.hasVoted) votesCast.add(0);
         
         // Update region
-        if (regions.find(voter.region) == regions.end()) {
-            regions[voter.region] = Region(voter.region);
-        }
-        regions[voter.region].totalVoters++;
+        regionFor(voter.region).totalVoters++;
         
         return true;
     }
     
-    Voter* findVoter(int id) {
-        for (auto& v : voters) {
-            if (v.id == id) {
-                return &v;
+    // Returns the slot of a voter, or -1 if not registered
+    int findVoterSlot(int id) const {
+        return voterIndex.find(id);
+    }
+    
+    Voter voterAt(int slot) const { return voters->row(slot); }
+    
+    // Bulk ingest, one hash pass for duplicates (first occurrence wins);
+    // rowNumbers, if given, are the row numbers reported for rejects
+    BulkLoadReport addVotersBulk(vector<Voter>&& rows, 
+                                 const vector<int>& rowNumbers = vector<int>()) {
+        detachVoters();
+        BulkLoadReport report;
+        size_t nameBytes = 0;
+        for (const auto& v : rows) nameBytes += v.name.size();
+        voters->reserve(voters->size() + rows.size(), voters->nameData.size() + nameBytes);
+        voterIndex.reserve(voters->size() + rows.size());
+        
+        vector<int> regionCounts(RegionName::count());
+        for (size_t i = 0; i < rows.size(); i++) {
+            int row = rowNumbers.empty() ? (int)i + 1 : rowNumbers[i];
+            if (!voterIndex.insert(rows[i].id, voters->size())) {
+                report.rejected.push_back(RejectedRow(row, rows[i].id, "duplicate voter ID"));
+                continue;
+            }
+            regionCounts[rows[i].region.id()]++;
+            if (rows[i].hasVoted) votesCast.add(0);
+            voters->append(rows[i]);
+            report.accepted++;
+        }
+        
+        for (size_t r = 0; r < regionCounts.size(); r++) {
+            if (regionCounts[r] > 0) {
+                regionFor(RegionName::fromId(r)).totalVoters += regionCounts[r];
             }
         }
-        return nullptr;
+        
+        rows.clear();
+        return report;
+    }
+    
+    // Columnar counterpart of addVotersBulk, for voters that were built as
+    // columns (see DatasetGenerator). Same duplicate rules; when nothing is
+    // rejected and there are no voters yet, the columns are adopted as is.
+    BulkLoadReport addVoterTable(VoterTable&& table) {
+        detachVoters();
+        BulkLoadReport report;
+        size_t base = voters->size();
+        voterIndex.reserve(base + table.size());
+        
+        vector<int> regionCounts(RegionName::count());
+        vector<size_t> kept;
+        size_t voted = 0;
+        for (size_t i = 0; i < table.size(); i++) {
+            if (!voterIndex.insert(table.ids[i], base + kept.size())) {
+                report.rejected.push_back(RejectedRow(i + 1, table.ids[i], "duplicate voter ID"));
+                continue;
+            }
+            regionCounts[table.regionIds[i]]++;
+            voted += table.voted.test(i);
+            kept.push_back(i);
+        }
+        report.accepted = kept.size();
+        
+        if (base == 0 && kept.size() == table.size()) {
+            voters = make_shared<VoterTable>(move(table));
+        } else {
+            voters->reserve(base + kept.size(), voters->nameData.size() + table.nameData.size());
+            for (size_t i : kept) voters->append(table.row(i));
+        }
+        
+        if (voted > 0) votesCast.add(0, voted);
+        for (size_t r = 0; r < regionCounts.size(); r++) {
+            if (regionCounts[r] > 0) {
+                regionFor(RegionName::fromId(r)).totalVoters += regionCounts[r];
+            }
+        }
+        return report;
+    }
+    
+    // Voters live in columns, so lookups return a materialized copy
+    optional<Voter> findVoter(int id) const {
+        int slot = findVoterSlot(id);
+        if (slot < 0) return nullopt;
+        return voters->row(slot);
     }
     
     bool castVote(int voterId, int candidateId) {
-        Voter* voter = findVoter(voterId);
-        Candidate* candidate = findCandidate(candidateId);
+        return castVote(voterId, candidateId, time(nullptr));
+    }
+    
+    bool castVote(int voterId, int candidateId, time_t when) {
+        int voterSlot = findVoterSlot(voterId);
+        int candidateSlot = findCandidateSlot(candidateId);
         
-        if (!voter || !candidate) {
+        if (voterSlot < 0 || candidateSlot < 0) {
             return false;
         }
         
-        if (voter->hasVoted) {
-            return false;
+        size_t gateSlot = writeGate.enter();
+        VoteStatus status = claimVote(voterSlot, candidateSlot, when);
+        if (status == VoteStatus::Accepted) {
+            tallyVotes(candidateSlot, 1);
         }
+        writeGate.exit(gateSlot);
         
-        // Check if voter and candidate are from same region
-        if (voter->region != candidate->region) {
+        if (status == VoteStatus::WrongRegion) {
             cout << "Error: Voter can only vote in their registered region!\n";
+        }
+        if (status != VoteStatus::Accepted) {
             return false;
         }
         
-        voter->hasVoted = true;
-        voter->voteTime = time(nullptr);
-        voter->votedFor = candidateId;
-        candidate->votes++;
-        regions[candidate->region].votesPolled++;
-        
+        // Not acknowledged until the record is on disk. A vote the journal
+        // fails to store stays counted but is reported as not cast.
+        if (journal && !journal->waitDurable(journal->append(voterId, candidateId, when))) {
+            cout << "Error: Vote could not be written to the journal!\n";
+            return false;
+        }
         return true;
     }
     
+    // Apply a batch of votes without printing; status[i] is the outcome of
+    // votes[i]. Of two votes by one voter the first wins.
+    vector<VoteStatus> castVotes(const VoteRequest* votes, size_t count,
+                                 time_t when = time(nullptr)) {
+        vector<VoteStatus> status(count, VoteStatus::Accepted);
+        vector<int> voterSlots(count), candidateSlots(count);
+        vector<int> regionStart(regions.size() + 1, 0);
+        
+        for (size_t i = 0; i < count; i++) {
+            voterSlots[i] = findVoterSlot(votes[i].voterId);
+            candidateSlots[i] = findCandidateSlot(votes[i].candidateId);
+            if (voterSlots[i] < 0) {
+                status[i] = VoteStatus::UnknownVoter;
+            } else if (candidateSlots[i] < 0) {
+                status[i] = VoteStatus::UnknownCandidate;
+            } else {
+                regionStart[voters->regionIds[voterSlots[i]] + 1]++;
+            }
+        }
+        for (size_t r = 1; r < regionStart.size(); r++) {
+            regionStart[r] += regionStart[r - 1];
+        }
+        vector<int> order(regionStart.back());
+        for (size_t i = 0; i < count; i++) {
+            if (status[i] == VoteStatus::Accepted) {
+                order[regionStart[voters->regionIds[voterSlots[i]]]++] = i;
+            }
+        }
+        
+        TallyScratch& accepted = tallyScratch();
+        if (accepted.votes.size() < candidates.size()) {
+            accepted.votes.resize(candidates.size(), 0);
+        }
+        vector<VoteRecord> journaled;
+        size_t gateSlot = writeGate.enter();
+        for (int i : order) {
+            time_t at = votes[i].voteTime ? votes[i].voteTime : when;
+            status[i] = claimVote(voterSlots[i], candidateSlots[i], at);
+            if (status[i] == VoteStatus::Accepted) {
+                if (accepted.votes[candidateSlots[i]]++ == 0) {
+                    accepted.touched.push_back(candidateSlots[i]);
+                }
+                if (journal) {
+                    journaled.push_back(VoteRecord(0, votes[i].voterId, votes[i].candidateId, at));
+                }
+            }
+        }
+        
+        for (int c : accepted.touched) {
+            tallyVotes(c, accepted.votes[c]);
+            accepted.votes[c] = 0;
+        }
+        accepted.touched.clear();
+        writeGate.exit(gateSlot);
+        
+        if (journal && !journaled.empty() && !journal->waitDurable(journal->appendBatch(journaled))) {
+            replace(status.begin(), status.end(), VoteStatus::Accepted, VoteStatus::NotJournaled);
+        }
+        return status;
+    }
+    
+    vector<VoteStatus> castVotes(const vector<VoteRequest>& votes) {
+        return castVotes(votes.data(), votes.size());
+    }
+    
+    // Journal every successful castVote from now on (nullptr to stop)
+    void attachJournal(VoteJournal* j) { journal = j; }
+    VoteJournal* getJournal() const { return journal; }
+    
+    // Re-apply the votes of a journal file with sequence > afterSequence.
+    // Votes already reflected in the database are skipped by castVote's
+    // own checks. Returns the number applied, or -1 if unreadable.
+    int replayJournal(const string& filename, uint64_t afterSequence = 0) {
+        vector<VoteRecord> records;
+        if (!VoteJournal::readAll(filename, records)) {
+            return -1;
+        }
+        
+        vector<VoteRequest> batch;
+        for (const auto& r : records) {
+            if (r.sequence > afterSequence) {
+                batch.push_back(VoteRequest(r.voterId, r.candidateId, (time_t)r.voteTime));
+            }
+        }
+        
+        VoteJournal* attached = journal;
+        journal = nullptr; // replayed votes are already in the log
+        vector<VoteStatus> status = castVotes(batch);
+        journal = attached;
+        return count(status.begin(), status.end(), VoteStatus::Accepted);
+    }
+    
     // Display Functions
     void displayAllCandidates() {
-        if (candidates.empty()) {
+        if (liveCandidates == 0) {
             cout << "\nNo candidates registered.\n";
             return;
         }
+        syncVotes();
         
         cout << "\n" << string(120, '=') << "\n";
         cout << left << setw(8) << "ID"
@@ -156,15 +844,15 @@ public:
              << setw(20) << "Qualification" << "\n";
         cout << string(120, '=') << "\n";
         
-        for (const auto& c : candidates) {
+        for (const auto& c : getAllCandidates()) {
             c.display();
         }
         cout << string(120, '=') << "\n";
-        cout << "Total Candidates: " << candidates.size() << "\n";
+        cout << "Total Candidates: " << liveCandidates << "\n";
     }
     
     void displayAllVoters() {
-        if (voters.empty()) {
+        if (voters->empty()) {
             cout << "\nNo voters registered.\n";
             return;
         }
@@ -178,18 +866,19 @@ public:
              << setw(20) << "Vote Time" << "\n";
         cout << string(100, '=') << "\n";
         
-        for (const auto& v : voters) {
-            v.display();
+        for (size_t i = 0; i < voters->size(); i++) {
+            voters->row(i).display();
         }
         cout << string(100, '=') << "\n";
-        cout << "Total Voters: " << voters.size() << "\n";
+        cout << "Total Voters: " << voters->size() << "\n";
     }
     
     void displayRegions() {
-        if (regions.empty()) {
+        if (registeredRegions == 0) {
             cout << "\nNo regions registered.\n";
             return;
         }
+        syncVotes();
         
         cout << "\n" << string(70, '=') << "\n";
         cout << left << setw(20) << "Region"
@@ -198,8 +887,30 @@ public:
              << setw(12) << "Turnout" << "\n";
         cout << string(70, '=') << "\n";
         
-        for (const auto& pair : regions) {
-            pair.second.display();
+        for (const auto& region : regions) {
+            if (region.isRegistered()) {
+                region.display();
+            }
+        }
+        cout << string(70, '=') << "\n";
+        
+        const vector<RegionRace>& races = getRegionRaces();
+        cout << left << setw(20) << "Region"
+             << setw(25) << "Leader"
+             << setw(10) << "Votes"
+             << setw(10) << "Margin" << "\n";
+        cout << string(70, '-') << "\n";
+        for (size_t r = 0; r < races.size(); r++) {
+            if (!regions[r].isRegistered() || races[r].winner < 0) continue;
+            cout << left << setw(20) << regions[r].name
+                 << setw(25) << candidates[races[r].winner].name
+                 << setw(10) << races[r].winnerVotes;
+            if (races[r].contested()) {
+                cout << setw(10) << races[r].margin();
+            } else {
+                cout << setw(10) << "-";
+            }
+            cout << "\n";
         }
         cout << string(70, '=') << "\n";
     }
@@ -207,55 +918,109 @@ public:
     // Statistics
     ElectionStats getStatistics() {
         ElectionStats stats;
-        stats.totalCandidates = candidates.size();
-        stats.totalVoters = voters.size();
+        stats.totalCandidates = liveCandidates;
+        stats.totalVoters = voters->size();
+        stats.totalVotesCast = votesCast.get(0);
+        stats.voterTurnout = (voters->size() > 0) ? 
+            (stats.totalVotesCast * 100.0 / voters->size()) : 0.0;
         
-        int votedCount = 0;
-        for (const auto& v : voters) {
-            if (v.hasVoted) {
-                votedCount++;
+        stats.partyWiseVotes.resize(partyCandidates.size(), 0);
+        stats.regionWiseVotes.resize(regionCandidates.size(), 0);
+        for (size_t p = 0; p < partyCandidates.size(); p++) {
+            if (partyCandidates[p] > 0) {
+                stats.parties.push_back(PartyName::fromId(p));
+                stats.partyWiseVotes[p] = partyVotes.get(p);
             }
         }
-        stats.totalVotesCast = votedCount;
-        stats.voterTurnout = (voters.size() > 0) ? 
-            (votedCount * 100.0 / voters.size()) : 0.0;
-        
-        // Party-wise votes
-        for (const auto& c : candidates) {
-            stats.partyWiseVotes[c.party] += c.votes;
-            stats.regionWiseVotes[c.region] += c.votes;
-            
-            if (c.votes > stats.maxVotes) {
-                stats.maxVotes = c.votes;
-                stats.leadingParty = c.party;
+        for (size_t r = 0; r < regionCandidates.size(); r++) {
+            if (regionCandidates[r] > 0) {
+                stats.regions.push_back(RegionName::fromId(r));
+                stats.regionWiseVotes[r] = regionVotes.get(r);
             }
         }
         
-        // Find leading party by total votes
-        int maxPartyVotes = 0;
-        for (const auto& pair : stats.partyWiseVotes) {
-            if (pair.second > maxPartyVotes) {
-                maxPartyVotes = pair.second;
-                stats.leadingParty = pair.first;
+        // Leader on read: O(parties), and no shared state for castVote
+        for (const auto& party : stats.parties) {
+            if (stats.leadingParty.isNull() || 
+                stats.partyWiseVotes[party.id()] > stats.maxVotes) {
+                stats.leadingParty = party;
+                stats.maxVotes = stats.partyWiseVotes[party.id()];
             }
         }
         
         return stats;
     }
     
+    // Consistent point-in-time copy for analytics (see view.h); writers
+    // are held off only while it is copied
+    ElectionView createView() {
+        ElectionView view;
+        vector<int> candidateTotals(candidates.size());
+        vector<int> polled(regions.size());
+        // Only the parties and regions that have had candidates are copied
+        size_t rows = regionPartyEpoch.size();
+        view.partyStride = partyCandidates.size();
+        view.regionPartyVotes.assign(rows * view.partyStride, 0);
+        
+        writeGate.exclusive([&] {
+            for (size_t i = 0; i < candidateTotals.size(); i++) {
+                candidateTotals[i] = candidateVotes.get(i);
+            }
+            for (size_t r = 0; r < polled.size(); r++) {
+                polled[r] = regionPolled.get(r);
+            }
+            for (size_t r = 0; r < rows; r++) {
+                if (r >= regionCandidates.size() || regionCandidates[r] == 0) continue;
+                for (size_t p = 0; p < view.partyStride; p++) {
+                    view.regionPartyVotes[r * view.partyStride + p] = 
+                        regionPartyVotes.get(r * partyStride + p);
+                }
+            }
+            view.stats = getStatistics();
+            view.voted = voters->voted;
+        });
+        
+        {
+            lock_guard<mutex> guard(syncLock);
+            vector<int> viewIndex(candidates.size(), -1);
+            view.candidates.reserve(liveCandidates);
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (!candidateLive[i]) continue;
+                candidates[i].votes = candidateTotals[i];
+                viewIndex[i] = view.candidates.size();
+                view.candidates.push_back(candidates[i]);
+            }
+            view.regions = regions;
+            
+            repairRanking();
+            view.ranking.reserve(rankOrder.size());
+            for (int slot : rankOrder) {
+                view.ranking.push_back(viewIndex[slot]);
+            }
+            view.regionRaces = regionRaces;
+            for (auto& race : view.regionRaces) {
+                if (race.winner >= 0) race.winner = viewIndex[race.winner];
+                if (race.runnerUp >= 0) race.runnerUp = viewIndex[race.runnerUp];
+            }
+            
+            refreshPartyOrder(view.regionPartyVotes, view.partyStride);
+            view.partyOrder = partyOrder;
+        }
+        for (size_t r = 0; r < polled.size(); r++) {
+            view.regions[r].votesPolled = polled[r];
+        }
+        view.registeredRegions = registeredRegions;
+        view.voters = voters;
+        return view;
+    }
+    
     // Results
     void displayResults() {
-        if (candidates.empty()) {
+        if (liveCandidates == 0) {
             cout << "\nNo candidates registered.\n";
             return;
         }
-        
-        // Sort by votes
-        vector<Candidate> sorted = candidates;
-        sort(sorted.begin(), sorted.end(), 
-             [](const Candidate& a, const Candidate& b) {
-                 return a.votes > b.votes;
-             });
+        CandidateSlice sorted = getRanking();
         
         int totalVotes = 0;
         for (const auto& c : sorted) {
@@ -291,16 +1056,18 @@ public:
     }
     
     void findWinner() {
-        if (candidates.empty()) {
+        if (liveCandidates == 0) {
             cout << "\nNo candidates registered.\n";
             return;
         }
+        syncVotes();
         
-        Candidate* winner = &candidates[0];
+        CandidateRange live = getAllCandidates();
+        const Candidate* winner = &*live.begin();
         int maxVotes = winner->votes;
         bool tie = false;
         
-        for (auto& c : candidates) {
+        for (const auto& c : live) {
             if (c.votes > maxVotes) {
                 winner = &c;
                 maxVotes = c.votes;
@@ -322,7 +1089,7 @@ public:
         if (tie) {
             cout << "There is a TIE with " << maxVotes << " votes!\n\n";
             cout << "Tied candidates:\n";
-            for (const auto& c : candidates) {
+            for (const auto& c : live) {
                 if (c.votes == maxVotes) {
                     cout << "  - " << c.name << " (" << c.party 
                          << ", " << c.region << ")\n";
@@ -338,13 +1105,48 @@ public:
     }
     
     // Getters
-    const vector<Candidate>& getAllCandidates() const { return candidates; }
-    const vector<Voter>& getAllVoters() const { return voters; }
-    const map<string, Region>& getAllRegions() const { return regions; }
+    // Live candidates by votes, most first (ties by slot): the maintained
+    // ranking, not a sorted copy. Valid until the next call or add/delete.
+    CandidateSlice getRanking() const {
+        lock_guard<mutex> guard(syncLock);
+        syncVotesLocked();
+        repairRanking();
+        return CandidateSlice(candidates.data(), rankOrder.data(), rankOrder.size());
+    }
+    
+    // Top two of every region, by RegionName id (slots, see candidateAt);
+    // valid until the next call or add/delete
+    const vector<RegionRace>& getRegionRaces() const {
+        lock_guard<mutex> guard(syncLock);
+        syncVotesLocked();
+        repairRanking();
+        return regionRaces;
+    }
+    
+    // Live candidates in slot order (deleted slots skipped), with votes
+    // refreshed from the live counters on every call
+    CandidateRange getAllCandidates() const {
+        syncVotes();
+        return CandidateRange(candidates.data(), candidateLive.data(), candidates.size(), liveCandidates);
+    }
+    const VoterTable& getVoterTable() const { return *voters; }
+    
+    // Turnout (%) over a subset of regions: popcount of voted & mask
+    double getTurnout(const vector<RegionName>& subset) const {
+        Bitmap mask = voters->regionMask(subset);
+        size_t registered = mask.count();
+        return (registered > 0) ? 
+            (voters->voted.countAndAtomic(mask) * 100.0 / registered) : 0.0;
+    }
+    // Dense by RegionName id; skip slots that are not isRegistered()
+    const vector<Region>& getAllRegions() const {
+        syncVotes();
+        return regions;
+    }
     
-    int getCandidateCount() const { return candidates.size(); }
-    int getVoterCount() const { return voters.size(); }
-    int getRegionCount() const { return regions.size(); }
+    int getCandidateCount() const { return liveCandidates; }
+    int getVoterCount() const { return voters->size(); }
+    int getRegionCount() const { return registeredRegions; }
 };
 
 #endif // DATABASE_H
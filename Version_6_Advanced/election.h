@@ -7,6 +7,7 @@
 #include <iostream>
 #include <iomanip>
 #include <ctime>
+#include "intern.h"
 
 using namespace std;
 
@@ -14,8 +15,8 @@ using namespace std;
 struct Candidate {
     int id;
     string name;
-    string party;
-    string region;
+    PartyName party;
+    RegionName region;
     int votes;
     int age;
     string qualification;
@@ -54,7 +55,7 @@ struct Candidate {
 struct Voter {
     int id;
     string name;
-    string region;
+    RegionName region;
     int age;
     bool hasVoted;
     time_t voteTime;
@@ -63,7 +64,7 @@ struct Voter {
     Voter() : id(0), name(""), region(""), age(0), hasVoted(false), 
               voteTime(0), votedFor(-1) {}
     
-    Voter(int vid, const string& vname, const string& vreg, int vage)
+    Voter(int vid, const string& vname, const RegionName& vreg, int vage)
         : id(vid), name(vname), region(vreg), age(vage), 
           hasVoted(false), voteTime(0), votedFor(-1) {}
     
@@ -84,18 +85,22 @@ struct Voter {
 };
 
 // Election Statistics
+// Tallies are dense arrays indexed by PartyName/RegionName id; parties
+// and regions list the ids that actually have candidates.
 struct ElectionStats {
     int totalCandidates;
     int totalVoters;
     int totalVotesCast;
     double voterTurnout;
-    string leadingParty;
+    PartyName leadingParty;
     int maxVotes;
-    map<string, int> partyWiseVotes;
-    map<string, int> regionWiseVotes;
+    vector<int> partyWiseVotes;
+    vector<int> regionWiseVotes;
+    vector<PartyName> parties;
+    vector<RegionName> regions;
     
     ElectionStats() : totalCandidates(0), totalVoters(0), totalVotesCast(0),
-                      voterTurnout(0.0), leadingParty(""), maxVotes(0) {}
+                      voterTurnout(0.0), maxVotes(0) {}
     
     void display() const {
         cout << "\n" << string(70, '=') << "\n";
@@ -109,32 +114,104 @@ struct ElectionStats {
         cout << "Leading Party: " << leadingParty << " (" << maxVotes << " votes)\n";
         
         cout << "\n--- Party-wise Vote Distribution ---\n";
-        for (const auto& pair : partyWiseVotes) {
+        for (const auto& party : parties) {
+            int votes = partyWiseVotes[party.id()];
             double percentage = (totalVotesCast > 0) ? 
-                (pair.second * 100.0 / totalVotesCast) : 0.0;
-            cout << left << setw(25) << pair.first 
-                 << ": " << pair.second << " votes (" 
+                (votes * 100.0 / totalVotesCast) : 0.0;
+            cout << left << setw(25) << party 
+                 << ": " << votes << " votes (" 
                  << percentage << "%)\n";
         }
         
         cout << "\n--- Region-wise Vote Distribution ---\n";
-        for (const auto& pair : regionWiseVotes) {
-            cout << left << setw(20) << pair.first 
-                 << ": " << pair.second << " votes\n";
+        for (const auto& region : regions) {
+            cout << left << setw(20) << region 
+                 << ": " << regionWiseVotes[region.id()] << " votes\n";
         }
         cout << string(70, '=') << "\n";
     }
 };
 
+// A row refused by a bulk load
+struct RejectedRow {
+    int row;
+    int id;
+    string reason;
+    
+    RejectedRow(int r, int rid, const string& why) : row(r), id(rid), reason(why) {}
+};
+
+// Outcome of ElectionDatabase::addVotersBulk / addCandidatesBulk
+struct BulkLoadReport {
+    int accepted;
+    vector<RejectedRow> rejected;
+    
+    BulkLoadReport() : accepted(0) {}
+    
+    void display(int maxRows = 10) const {
+        if (rejected.empty()) return;
+        
+        cout << "Rejected " << rejected.size() << " row(s):\n";
+        int shown = min(maxRows, (int)rejected.size());
+        for (int i = 0; i < shown; i++) {
+            cout << "  Row " << rejected[i].row;
+            if (rejected[i].id != 0) {
+                cout << " (ID " << rejected[i].id << ")";
+            }
+            cout << ": " << rejected[i].reason << "\n";
+        }
+        if ((int)rejected.size() > shown) {
+            cout << "  ... and " << (rejected.size() - shown) << " more\n";
+        }
+    }
+};
+
+// One vote in a ElectionDatabase::castVotes batch. A voteTime of 0
+// means "when the batch is applied".
+struct VoteRequest {
+    int voterId;
+    int candidateId;
+    time_t voteTime;
+    
+    VoteRequest() : voterId(0), candidateId(0), voteTime(0) {}
+    VoteRequest(int vid, int cid, time_t when = 0) 
+        : voterId(vid), candidateId(cid), voteTime(when) {}
+};
+
+// Outcome of one vote in a batch
+enum class VoteStatus : unsigned char {
+    Accepted,
+    UnknownVoter,
+    UnknownCandidate,
+    AlreadyVoted,
+    WrongRegion,
+    NotJournaled    // counted, but the journal could not store it
+};
+
+inline const char* voteStatusName(VoteStatus status) {
+    switch (status) {
+        case VoteStatus::Accepted:         return "accepted";
+        case VoteStatus::UnknownVoter:     return "unknown voter";
+        case VoteStatus::UnknownCandidate: return "unknown candidate";
+        case VoteStatus::AlreadyVoted:     return "already voted";
+        case VoteStatus::WrongRegion:      return "candidate not in voter's region";
+        case VoteStatus::NotJournaled:     return "not written to journal";
+    }
+    return "";
+}
+
 // Region/Constituency Structure
+// Stored densely by RegionName id; slots never registered keep a null name.
 struct Region {
-    string name;
+    RegionName name;
     int totalVoters;
     int votesPolled;
     vector<int> candidateIds;
     
-    Region() : name(""), totalVoters(0), votesPolled(0) {}
-    Region(const string& n) : name(n), totalVoters(0), votesPolled(0) {}
+    Region() : totalVoters(0), votesPolled(0) {}
+    Region(const RegionName& n) : name(n), totalVoters(0), votesPolled(0) {}
+    
+    bool isRegistered() const { return !name.isNull(); }
     
     double getTurnout() const {
         return (totalVoters > 0) ? (votesPolled * 100.0 / totalVoters) : 0.0;
@@ -149,4 +226,18 @@ struct Region {
     }
 };
 
+// Top two candidates of one region, as indexes into the candidate list
+// it was computed from (-1 when the region has fewer candidates)
+struct RegionRace {
+    int winner;
+    int runnerUp;
+    int winnerVotes;
+    int runnerUpVotes;
+    
+    RegionRace() : winner(-1), runnerUp(-1), winnerVotes(0), runnerUpVotes(0) {}
+    
+    bool contested() const { return runnerUp >= 0; }
+    int margin() const { return winnerVotes - runnerUpVotes; }
+};
+
 #endif // ELECTION_H
@@ -0,0 +1,431 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "database.h"
+#include "snapshot.h"
+#include "csv.h"
+#include "parallel.h"
+#include "rng.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <climits>
+#include <charconv>
+#include <algorithm>
+
+using namespace std;
+
+// Shape of a synthetic election. The defaults are the small sample
+// election of the utilities menu.
+struct DatasetSpec {
+    uint64_t seed;
+    size_t voters;
+    int candidates;
+    int regions;
+    int parties;
+    int minAge, maxAge;         // voter ages, from a normal distribution
+    double ageMean;             // truncated to [minAge, maxAge]
+    double ageSpread;
+    double regionSkew;          // Zipf exponent of region sizes (0 = equal)
+    int firstVoterId;
+    int firstCandidateId;
+    unsigned threads;           // 0 = one per hardware thread
+    
+    DatasetSpec()
+        : seed(12345), voters(100), candidates(25), regions(5), parties(5),
+          minAge(18), maxAge(80), ageMean(45.0), ageSpread(17.0), regionSkew(0.0),
+          firstVoterId(5000), firstCandidateId(1000), threads(0) {}
+};
+
+// Deterministic, parallel generator for large synthetic elections.
+//
+// Voters are produced in fixed blocks of BLOCK, each from its own
+// generator seeded with the spec seed and the block number, so a spec
+// always gives the same dataset whatever the thread count, and any block
+// can be produced on its own. That lets writeCsv and writeSnapshot stream
+// a dataset of any size in bounded memory, while load builds the voter
+// columns directly (no per-voter Voter objects) for addVoterTable.
+class DatasetGenerator {
+private:
+    DatasetSpec spec;
+    vector<RegionName> regionNames;
+    vector<PartyName> partyNames;
+    vector<string> fullNames;           // every first + last name pair
+    
+    // Walker alias table over the regions: pick a column uniformly, then
+    // keep it with probability regionKeep or take its regionAlias. One
+    // draw per voter however many regions there are.
+    vector<double> regionKeep;
+    vector<int> regionAlias;
+    
+    static const vector<string>& firstNames() {
+        static const vector<string> names = {"John", "Jane", "Michael", "Sarah", "David",
+                                             "Emily", "Robert", "Lisa", "James", "Mary"};
+        return names;
+    }
+    
+    static const vector<string>& lastNames() {
+        static const vector<string> names = {"Smith", "Johnson", "Williams", "Brown", "Jones",
+                                             "Garcia", "Miller", "Davis", "Rodriguez", "Martinez"};
+        return names;
+    }
+    
+    // Voters of one block, as columns plus their names back to back
+    struct VoterBlock {
+        vector<int> ages;
+        vector<int> regions;        // indexes into regionNames
+        vector<uint32_t> nameLengths;
+        string names;
+    };
+    
+    void makeVoters(size_t b, VoterBlock& out) const {
+        FastRng rng(spec.seed, b + 1);
+        size_t first = b * BLOCK;
+        size_t count = min(BLOCK, spec.voters - first);
+        out.ages.resize(count);
+        out.regions.resize(count);
+        out.nameLengths.resize(count);
+        out.names.clear();
+        
+        for (size_t i = 0; i < count; i++) {
+            const string& name = fullNames[rng.below(fullNames.size())];
+            out.names.append(name);
+            out.nameLengths[i] = name.size();
+            
+            double u = rng.uniform() * regionKeep.size();
+            size_t column = min((size_t)u, regionKeep.size() - 1);
+            out.regions[i] = (u - column < regionKeep[column]) ? column : regionAlias[column];
+            out.ages[i] = drawAge(rng);
+        }
+    }
+    
+    // Make every block, a batch at a time in parallel, and hand them to
+    // use(block, part) in block order, so only a batch is held at once
+    template <typename Use>
+    void streamBlocks(Use use) const {
+        size_t blocks = blockCount();
+        unsigned threads = spec.threads ? spec.threads : ParallelUtils::defaultThreads();
+        size_t batch = threads * 2;
+        vector<VoterBlock> parts(min(batch, blocks));
+        for (size_t start = 0; start < blocks; start += batch) {
+            size_t count = min(batch, blocks - start);
+            ParallelUtils::forEach(count, [&](size_t k) {
+                makeVoters(start + k, parts[k]);
+            }, threads);
+            for (size_t k = 0; k < count; k++) use(start + k, parts[k]);
+        }
+    }
+    
+    // Region r has weight 1 / (r + 1)^regionSkew
+    void buildRegionAlias() {
+        size_t n = regionNames.size();
+        vector<double> scaled(n);
+        double total = 0;
+        for (size_t r = 0; r < n; r++) {
+            scaled[r] = 1.0 / pow((double)(r + 1), spec.regionSkew);
+            total += scaled[r];
+        }
+        
+        vector<int> small, large;
+        for (size_t r = 0; r < n; r++) {
+            scaled[r] *= n / total;
+            (scaled[r] < 1.0 ? small : large).push_back(r);
+        }
+        regionKeep.assign(n, 1.0);
+        regionAlias.assign(n, 0);
+        for (size_t r = 0; r < n; r++) regionAlias[r] = r;
+        while (!small.empty() && !large.empty()) {
+            int s = small.back(), l = large.back();
+            small.pop_back();
+            regionKeep[s] = scaled[s];
+            regionAlias[s] = l;
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+    }
+    
+    int drawAge(FastRng& rng) const {
+        for (int attempt = 0; attempt < 8; attempt++) {
+            double age = floor(spec.ageMean + spec.ageSpread * rng.normal() + 0.5);
+            if (age >= spec.minAge && age <= spec.maxAge) return (int)age;
+        }
+        return spec.minAge + (int)rng.below(spec.maxAge - spec.minAge + 1);
+    }
+
+public:
+    static constexpr size_t BLOCK = 1 << 16;
+    
+    explicit DatasetGenerator(const DatasetSpec& s) : spec(s) {
+        static const char* districts[] = {"North District", "South District", "East District",
+                                          "West District", "Central District"};
+        static const char* knownParties[] = {"Democratic Party", "Republican Party",
+                                             "Independent", "Green Party", "Liberal Party"};
+        for (int r = 0; r < spec.regions; r++) {
+            regionNames.push_back(RegionName(r < 5 ? string(districts[r]) :
+                                             "District " + to_string(r + 1)));
+        }
+        for (int p = 0; p < spec.parties; p++) {
+            partyNames.push_back(PartyName(p < 5 ? string(knownParties[p]) :
+                                           "Party " + to_string(p + 1)));
+        }
+        for (const auto& first : firstNames()) {
+            for (const auto& last : lastNames()) fullNames.push_back(first + " " + last);
+        }
+        buildRegionAlias();
+    }
+    
+    // Empty if the spec can be generated, else the reason it cannot
+    static string checkSpec(const DatasetSpec& s) {
+        if (s.regions < 1 || s.parties < 1) return "need at least one region and one party";
+        if (s.candidates < 0) return "candidate count cannot be negative";
+        if (s.minAge > s.maxAge) return "minimum age is above the maximum";
+        if (s.ageSpread < 0) return "age spread cannot be negative";
+        if (s.voters > (size_t)INT_MAX || s.firstVoterId < 0 ||
+            (long long)s.firstVoterId + (long long)s.voters - 1 > INT_MAX) {
+            return "voter ids would not fit in an int";
+        }
+        if (s.firstCandidateId < 0 || (long long)s.firstCandidateId + s.candidates - 1 > INT_MAX) {
+            return "candidate ids would not fit in an int";
+        }
+        return "";
+    }
+    
+    size_t blockCount() const { return (spec.voters + BLOCK - 1) / BLOCK; }
+    
+    // Candidates go round the regions, so every region has one as soon
+    // as there are at least as many candidates as regions
+    vector<Candidate> makeCandidates() const {
+        static const char* qualifications[] = {"Graduate", "Post-Graduate", "PhD",
+                                               "Professional", "Diploma"};
+        FastRng rng(spec.seed, 0);
+        vector<Candidate> rows(spec.candidates);
+        for (int i = 0; i < spec.candidates; i++) {
+            Candidate& c = rows[i];
+            c.id = spec.firstCandidateId + i;
+            c.name = fullNames[rng.below(fullNames.size())];
+            c.party = partyNames[rng.below(partyNames.size())];
+            c.region = regionNames[i % regionNames.size()];
+            c.age = 25 + (int)rng.below(46); // 25-70 years
+            c.qualification = qualifications[rng.below(5)];
+        }
+        return rows;
+    }
+    
+    // All voters as columns. Blocks are made in parallel and write their
+    // fixed-width columns in place; only the names wait for their offsets.
+    VoterTable makeVoterTable() const {
+        size_t n = spec.voters;
+        size_t blocks = blockCount();
+        
+        VoterTable table;
+        table.ids.resize(n);
+        table.ages.resize(n);
+        table.regionIds.resize(n);
+        table.votedFor.assign(n, -1);
+        table.voteTimes.assign(n, 0);
+        table.nameOffsets.resize(n + 1);
+        table.voted.assign(vector<uint64_t>((n + 63) / 64, 0), n);
+        
+        vector<VoterBlock> parts(blocks);
+        ParallelUtils::forEach(blocks, [&](size_t b) {
+            VoterBlock& part = parts[b];
+            makeVoters(b, part);
+            size_t first = b * BLOCK;
+            for (size_t i = 0; i < part.ages.size(); i++) {
+                table.ids[first + i] = spec.firstVoterId + (int)(first + i);
+                table.ages[first + i] = part.ages[i];
+                table.regionIds[first + i] = regionNames[part.regions[i]].id();
+            }
+            vector<int>().swap(part.ages);
+            vector<int>().swap(part.regions);
+        }, spec.threads);
+        
+        vector<size_t> nameStart(blocks + 1, 0);
+        for (size_t b = 0; b < blocks; b++) {
+            nameStart[b + 1] = nameStart[b] + parts[b].names.size();
+        }
+        table.nameData.resize(nameStart[blocks]);
+        
+        ParallelUtils::forEach(blocks, [&](size_t b) {
+            VoterBlock& part = parts[b];
+            size_t first = b * BLOCK;
+            size_t offset = nameStart[b];
+            for (size_t i = 0; i < part.nameLengths.size(); i++) {
+                table.nameOffsets[first + i] = offset;
+                offset += part.nameLengths[i];
+            }
+            copy(part.names.begin(), part.names.end(), table.nameData.begin() + nameStart[b]);
+            part = VoterBlock();
+        }, spec.threads);
+        table.nameOffsets[n] = nameStart[blocks];
+        return table;
+    }
+    
+    // Add the dataset to db; ids db already has are rejected in the reports
+    void load(ElectionDatabase& db, BulkLoadReport& candidateReport,
+              BulkLoadReport& voterReport) const {
+        candidateReport = db.addCandidatesBulk(makeCandidates());
+        voterReport = db.addVoterTable(makeVoterTable());
+    }
+    
+    // Write the dataset as CSV files that loadCandidatesFromFile and
+    // loadVotersFromFile read. Voters are formatted a batch of blocks at a
+    // time in parallel and written in order, so memory stays bounded.
+    bool writeCsv(const string& candidateFile, const string& voterFile) const {
+        FILE* file = fopen(candidateFile.c_str(), "wb");
+        if (!file) return false;
+        string text = "ID,Name,Party,Region,Votes,Age,Qualification\n";
+        for (const auto& c : makeCandidates()) {
+            text += to_string(c.id) + "," + CsvReader::escape(c.name) + "," +
+                    CsvReader::escape(c.party.str()) + "," +
+                    CsvReader::escape(c.region.str()) + ",0," + to_string(c.age) + "," +
+                    CsvReader::escape(c.qualification) + "\n";
+        }
+        fwrite(text.data(), 1, text.size(), file);
+        bool ok = !ferror(file);
+        fclose(file);
+        if (!ok) return false;
+        
+        file = fopen(voterFile.c_str(), "wb");
+        if (!file) return false;
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        fputs("ID,Name,Region,Age,HasVoted,VotedFor\n", file);
+        
+        vector<string> regionText;
+        for (const auto& r : regionNames) regionText.push_back(CsvReader::escape(r.str()));
+        
+        size_t blocks = blockCount();
+        unsigned threads = spec.threads ? spec.threads : ParallelUtils::defaultThreads();
+        size_t batch = threads * 2;
+        vector<string> lines(batch);
+        for (size_t start = 0; start < blocks && ok; start += batch) {
+            size_t count = min(batch, blocks - start);
+            ParallelUtils::forEach(count, [&](size_t k) {
+                VoterBlock part;
+                makeVoters(start + k, part);
+                string& out = lines[k];
+                out.clear();
+                char number[16];
+                auto appendNumber = [&](int value) {
+                    out.append(number, to_chars(number, number + sizeof(number), value).ptr);
+                };
+                size_t first = (start + k) * BLOCK, offset = 0;
+                for (size_t i = 0; i < part.ages.size(); i++) {
+                    appendNumber(spec.firstVoterId + (int)(first + i));
+                    out.append(1, ',').append(part.names, offset, part.nameLengths[i]).append(1, ',');
+                    offset += part.nameLengths[i];
+                    out.append(regionText[part.regions[i]]).append(1, ',');
+                    appendNumber(part.ages[i]);
+                    out.append(",0,-1\n");
+                }
+            }, threads);
+            for (size_t k = 0; k < count; k++) {
+                fwrite(lines[k].data(), 1, lines[k].size(), file);
+            }
+            ok = !ferror(file);
+        }
+        fclose(file);
+        return ok;
+    }
+    
+    // Write the dataset as a snapshot that ElectionSnapshot::load reads,
+    // byte for byte what load() + ElectionSnapshot::save would write.
+    // Each voter column is streamed to the file a batch of blocks at a
+    // time, remaking the blocks for every column that needs them; only
+    // the voter id index is built in full.
+    bool writeSnapshot(const string& filename) const {
+        typedef ElectionSnapshot::Writer Writer;
+        size_t n = spec.voters;
+        
+        // Candidates and the regions they register, as a database would
+        // hold them, plus the voters of every region
+        ElectionDatabase candidateDb;
+        candidateDb.addCandidatesBulk(makeCandidates());
+        vector<Region> regions = candidateDb.getAllRegions();
+        vector<int> regionCounts(regionNames.size(), 0);
+        streamBlocks([&](size_t, const VoterBlock& part) {
+            for (int r : part.regions) regionCounts[r]++;
+        });
+        for (size_t r = 0; r < regionNames.size(); r++) {
+            if (regionCounts[r] == 0) continue;
+            size_t id = regionNames[r].id();
+            if (id >= regions.size()) regions.resize(id + 1);
+            regions[id].name = regionNames[r];
+            regions[id].totalVoters += regionCounts[r];
+        }
+        
+        // A column of count copies of value, a block's worth at a time
+        auto fill = [](Writer& out, size_t count, auto value) {
+            vector<decltype(value)> chunk(min(count, BLOCK), value);
+            out.begin(count * sizeof(value));
+            for (size_t done = 0; done < count; done += chunk.size()) {
+                out.piece(chunk.data(), min(chunk.size(), count - done) * sizeof(value));
+            }
+            out.end();
+        };
+        
+        return ElectionSnapshot::write(filename, 0, [&](Writer& out) {
+            ElectionSnapshot::writeHead(out, candidateDb.getAllCandidates().toVector(), regions);
+            
+            vector<int> ints(BLOCK);
+            out.begin(n * sizeof(int));
+            for (size_t first = 0; first < n; first += BLOCK) {
+                size_t count = min(BLOCK, n - first);
+                for (size_t i = 0; i < count; i++) ints[i] = spec.firstVoterId + (int)(first + i);
+                out.piece(ints.data(), count * sizeof(int));
+            }
+            out.end();
+            
+            out.begin(n * sizeof(int));
+            streamBlocks([&](size_t, const VoterBlock& part) {
+                out.piece(part.ages.data(), part.ages.size() * sizeof(int));
+            });
+            out.end();
+            
+            out.begin(n * sizeof(int));
+            streamBlocks([&](size_t, const VoterBlock& part) {
+                for (size_t i = 0; i < part.regions.size(); i++) {
+                    ints[i] = regionNames[part.regions[i]].id();
+                }
+                out.piece(ints.data(), part.regions.size() * sizeof(int));
+            });
+            out.end();
+            
+            out.scalar(n);
+            fill(out, (n + 63) / 64, uint64_t(0));  // voted
+            fill(out, n, int(-1));                  // votedFor
+            fill(out, n, time_t(0));                // voteTimes
+            
+            size_t nameBytes = 0;
+            vector<size_t> offsets;
+            out.begin((n + 1) * sizeof(size_t));
+            out.piece(&nameBytes, sizeof(size_t));
+            streamBlocks([&](size_t, const VoterBlock& part) {
+                offsets.resize(part.nameLengths.size());
+                for (size_t i = 0; i < offsets.size(); i++) {
+                    nameBytes += part.nameLengths[i];
+                    offsets[i] = nameBytes;
+                }
+                out.piece(offsets.data(), offsets.size() * sizeof(size_t));
+            });
+            out.end();
+            
+            out.begin(nameBytes);
+            streamBlocks([&](size_t, const VoterBlock& part) {
+                out.piece(part.names.data(), part.names.size());
+            });
+            out.end();
+            
+            IdIndex index;
+            index.reserve(n);
+            for (size_t i = 0; i < n; i++) index.insert(spec.firstVoterId + (int)i, i);
+            ElectionSnapshot::writeVoterIndex(out, index);
+        });
+    }
+};
+
+#endif // GENERATOR_H
@@ -0,0 +1,186 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "bitmap.h"
+#include "parallel.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HISTOGRAM_SSE2
+#endif
+
+using namespace std;
+
+// Histogram of voter ages over configurable brackets, with turnout per
+// bracket. Brackets are given by ascending lower edges: {18, 26, 36}
+// means 18-25, 26-35 and 36+. Bin 0 collects ages below the first edge.
+//
+// count() never classifies a voter. For every edge it counts the voters
+// with age >= edge (and how many of those voted), which is one compare
+// per voter per edge - eight voters per SSE2 instruction - and takes the
+// bins as differences of those running totals. Edges must lie within
+// [MIN_EDGE, MAX_EDGE] so they survive packing to 16 bits.
+class AgeHistogram {
+private:
+    vector<int> edges;
+    vector<int> totals;     // by bin
+    vector<int> voted;      // by bin
+    
+    // Add the "age >= edge" counts of voters [begin, end) to atLeast and
+    // votedAtLeast (one entry per edge). begin must be a multiple of 64.
+    static void countAtLeast(const int* ages, const uint64_t* votedWords,
+                             size_t begin, size_t end, const vector<int>& edges,
+                             long long* atLeast, long long* votedAtLeast) {
+        size_t k = edges.size();
+        size_t simdEnd = begin;
+#ifdef HISTOGRAM_SSE2
+        // Ages are packed to 16 bits (saturating, harmless since edges
+        // fit in 16 bits), so one compare covers eight voters. Lane l of
+        // laneMask[m] is all ones when bit l of m is set.
+        static const struct LaneMasks {
+            __m128i mask[256];
+            LaneMasks() {
+                for (int m = 0; m < 256; m++) {
+                    short lane[8];
+                    for (int l = 0; l < 8; l++) lane[l] = ((m >> l) & 1) ? -1 : 0;
+                    mask[m] = _mm_loadu_si128((const __m128i*)lane);
+                }
+            }
+        } lanes;
+        
+        // Edges are taken EDGE_GROUP at a time so their counters stay in
+        // registers. 16-bit lane counters gain at most 8 per word, so they
+        // are flushed every 64 words (4096 voters), far below overflow.
+        const size_t EDGE_GROUP = 8;
+        simdEnd = begin + (end - begin) / 64 * 64;
+        for (size_t first = 0; first < k; first += EDGE_GROUP) {
+            size_t group = min(EDGE_GROUP, k - first);
+            __m128i below[EDGE_GROUP], count[EDGE_GROUP], votedCount[EDGE_GROUP];
+            for (size_t e = 0; e < group; e++) {
+                below[e] = _mm_set1_epi16((short)(edges[first + e] - 1));
+            }
+            
+            for (size_t flush = begin; flush < simdEnd; flush += 64 * 64) {
+                for (size_t e = 0; e < group; e++) {
+                    count[e] = votedCount[e] = _mm_setzero_si128();
+                }
+                
+                size_t stop = min(simdEnd, flush + 64 * 64);
+                for (size_t base = flush; base < stop; base += 64) {
+                    uint64_t bits = votedWords[base / 64];
+                    const __m128i* block = (const __m128i*)(ages + base);
+                    for (int q = 0; q < 8; q++, bits >>= 8) {
+                        __m128i age = _mm_packs_epi32(_mm_loadu_si128(block + 2 * q),
+                                                      _mm_loadu_si128(block + 2 * q + 1));
+                        __m128i hasVoted = lanes.mask[bits & 255];
+                        for (size_t e = 0; e < group; e++) {
+                            __m128i hit = _mm_cmpgt_epi16(age, below[e]);
+                            count[e] = _mm_sub_epi16(count[e], hit);
+                            votedCount[e] = _mm_sub_epi16(votedCount[e], _mm_and_si128(hit, hasVoted));
+                        }
+                    }
+                }
+                
+                for (size_t e = 0; e < group; e++) {
+                    short lane[8];
+                    _mm_storeu_si128((__m128i*)lane, count[e]);
+                    for (int l = 0; l < 8; l++) atLeast[first + e] += lane[l];
+                    _mm_storeu_si128((__m128i*)lane, votedCount[e]);
+                    for (int l = 0; l < 8; l++) votedAtLeast[first + e] += lane[l];
+                }
+            }
+        }
+#endif
+        // Scalar path (the tail, or everything without SSE2)
+        for (size_t i = simdEnd; i < end; i++) {
+            int hasVoted = (votedWords[i / 64] >> (i % 64)) & 1;
+            for (size_t e = 0; e < k; e++) {
+                int hit = ages[i] >= edges[e];
+                atLeast[e] += hit;
+                votedAtLeast[e] += hit & hasVoted;
+            }
+        }
+    }
+
+public:
+    // Lower edges must be ascending; an empty list gives a single bin
+    explicit AgeHistogram(const vector<int>& lowerEdges = standardEdges())
+        : edges(lowerEdges), totals(lowerEdges.size() + 1, 0),
+          voted(lowerEdges.size() + 1, 0) {}
+    
+    // 18-25, 26-35, 36-50, 51-65, 66+
+    static vector<int> standardEdges() { return {18, 26, 36, 51, 66}; }
+    
+    static const int MIN_EDGE = -32767;
+    static const int MAX_EDGE = 32767;
+    
+    static bool validEdges(const vector<int>& lowerEdges) {
+        for (size_t i = 0; i < lowerEdges.size(); i++) {
+            if (lowerEdges[i] < MIN_EDGE || lowerEdges[i] > MAX_EDGE) return false;
+            if (i > 0 && lowerEdges[i] <= lowerEdges[i - 1]) return false;
+        }
+        return true;
+    }
+    
+    const vector<int>& getEdges() const { return edges; }
+    
+    // Bin 0 is "below the first edge"
+    size_t binCount() const { return totals.size(); }
+    int total(size_t bin) const { return totals[bin]; }
+    int votedIn(size_t bin) const { return voted[bin]; }
+    
+    double turnout(size_t bin) const {
+        return (totals[bin] > 0) ? (voted[bin] * 100.0 / totals[bin]) : 0.0;
+    }
+    
+    string label(size_t bin) const {
+        if (edges.empty()) return "All";
+        if (bin == 0) return "<" + to_string(edges[0]);
+        if (bin == edges.size()) return to_string(edges.back()) + "+";
+        return to_string(edges[bin - 1]) + "-" + to_string(edges[bin] - 1);
+    }
+    
+    // Add voter i's age ages[i] and voted flag hasVoted.test(i), for
+    // every voter of hasVoted. Large rolls are split into 64K-voter blocks
+    // counted in parallel.
+    void count(const int* ages, const Bitmap& hasVoted) {
+        const uint64_t* votedWords = hasVoted.data().data();
+        size_t n = hasVoted.size();
+        const size_t block = 1 << 16;   // a multiple of 64
+        size_t blocks = (n + block - 1) / block;
+        size_t k = edges.size();
+        vector<long long> partial(blocks * 2 * k, 0);
+        
+        ParallelUtils::forEach(blocks, [&](size_t b) {
+            long long* atLeast = &partial[b * 2 * k];
+            countAtLeast(ages, votedWords, b * block, min(n, (b + 1) * block),
+                         edges, atLeast, atLeast + k);
+        });
+        
+        vector<long long> atLeast(k, 0), votedAtLeast(k, 0);
+        for (size_t b = 0; b < blocks; b++) {
+            for (size_t e = 0; e < k; e++) {
+                atLeast[e] += partial[b * 2 * k + e];
+                votedAtLeast[e] += partial[b * 2 * k + k + e];
+            }
+        }
+        
+        long long votedAll = hasVoted.count();
+        
+        // Bin b holds the voters at or above edge b-1 but not edge b
+        for (size_t bin = 0; bin <= k; bin++) {
+            long long from = (bin == 0) ? (long long)n : atLeast[bin - 1];
+            long long votedFrom = (bin == 0) ? votedAll : votedAtLeast[bin - 1];
+            long long to = (bin == k) ? 0 : atLeast[bin];
+            long long votedTo = (bin == k) ? 0 : votedAtLeast[bin];
+            totals[bin] += (int)(from - to);
+            voted[bin] += (int)(votedFrom - votedTo);
+        }
+    }
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,136 @@
+#ifndef IDINDEX_H
+#define IDINDEX_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Open-addressing hash index from an int id to an int slot.
+//
+// Linear probing over two flat arrays (no per-entry allocation), so a
+// lookup is usually one or two cache lines, and the whole table can be
+// written to a snapshot and loaded back with two bulk copies. Erase uses
+// backward-shift deletion, so there are no tombstones to clean up.
+class IdIndex {
+private:
+    vector<int> keys;
+    vector<int> values;     // -1 marks an empty bucket
+    size_t used;
+    
+    static size_t hash(int id) {
+        uint32_t x = (uint32_t)id;
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+    
+    size_t bucket(int id) const { return hash(id) & (keys.size() - 1); }
+    
+    void rehash(size_t capacity) {
+        vector<int> oldKeys, oldValues;
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        keys.assign(capacity, 0);
+        values.assign(capacity, -1);
+        
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldValues[i] >= 0) {
+                size_t b = bucket(oldKeys[i]);
+                while (values[b] >= 0) b = (b + 1) & (capacity - 1);
+                keys[b] = oldKeys[i];
+                values[b] = oldValues[i];
+            }
+        }
+    }
+
+public:
+    IdIndex() : keys(16, 0), values(16, -1), used(0) {}
+    
+    size_t size() const { return used; }
+    
+    // Make room for n entries without rehashing (load factor <= 1/2)
+    void reserve(size_t n) {
+        size_t capacity = keys.size();
+        while (capacity < n * 2) capacity *= 2;
+        if (capacity != keys.size()) rehash(capacity);
+    }
+    
+    // Returns false (and changes nothing) if id is already present
+    bool insert(int id, int slot) {
+        if ((used + 1) * 2 > keys.size()) rehash(keys.size() * 2);
+        
+        size_t b = bucket(id);
+        while (values[b] >= 0) {
+            if (keys[b] == id) return false;
+            b = (b + 1) & (keys.size() - 1);
+        }
+        keys[b] = id;
+        values[b] = slot;
+        used++;
+        return true;
+    }
+    
+    // Slot for id, or -1
+    int find(int id) const {
+        size_t b = bucket(id);
+        while (values[b] >= 0) {
+            if (keys[b] == id) return values[b];
+            b = (b + 1) & (keys.size() - 1);
+        }
+        return -1;
+    }
+    
+    bool contains(int id) const { return find(id) >= 0; }
+    
+    // Re-point an existing id at a new slot
+    void update(int id, int slot) {
+        size_t b = bucket(id);
+        while (values[b] >= 0) {
+            if (keys[b] == id) {
+                values[b] = slot;
+                return;
+            }
+            b = (b + 1) & (keys.size() - 1);
+        }
+    }
+    
+    bool erase(int id) {
+        size_t mask = keys.size() - 1;
+        size_t b = bucket(id);
+        while (values[b] >= 0 && keys[b] != id) b = (b + 1) & mask;
+        if (values[b] < 0) return false;
+        
+        // Shift later members of the probe run back into the hole
+        size_t hole = b;
+        size_t next = (b + 1) & mask;
+        while (values[next] >= 0) {
+            size_t home = bucket(keys[next]);
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                keys[hole] = keys[next];
+                values[hole] = values[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        values[hole] = -1;
+        used--;
+        return true;
+    }
+    
+    // Raw tables, for snapshots
+    const vector<int>& rawKeys() const { return keys; }
+    const vector<int>& rawValues() const { return values; }
+    
+    void assignRaw(vector<int>&& k, vector<int>&& v, size_t count) {
+        keys = move(k);
+        values = move(v);
+        used = count;
+    }
+};
+
+#endif // IDINDEX_H
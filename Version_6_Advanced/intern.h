@@ -0,0 +1,110 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <iostream>
+
+using namespace std;
+
+// String dictionary: every distinct string gets a small dense id (0, 1, 2...)
+// Strings live in a deque, so references and the string_view keys of the
+// lookup table stay valid as the pool grows.
+class StringPool {
+private:
+    mutable mutex lock;
+    deque<string> names;
+    unordered_map<string_view, int> ids;
+
+public:
+    int intern(string_view s) {
+        lock_guard<mutex> guard(lock);
+        auto it = ids.find(s);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        
+        names.emplace_back(s);
+        int id = names.size() - 1;
+        ids.emplace(string_view(names.back()), id);
+        return id;
+    }
+    
+    // Returns -1 if s was never interned
+    int find(string_view s) const {
+        lock_guard<mutex> guard(lock);
+        auto it = ids.find(s);
+        return (it != ids.end()) ? it->second : -1;
+    }
+    
+    const string& name(int id) const {
+        lock_guard<mutex> guard(lock);
+        return names[id];
+    }
+    
+    int size() const {
+        lock_guard<mutex> guard(lock);
+        return names.size();
+    }
+};
+
+// A string stored as its id in a per-Tag global pool. Comparing two
+// names is an int compare; printing looks the text up in the pool.
+// A default-constructed name is null (id -1) and prints as "".
+template <typename Tag>
+class InternedName {
+private:
+    int index;
+
+public:
+    static StringPool& pool() {
+        static StringPool instance;
+        return instance;
+    }
+    
+    InternedName() : index(-1) {}
+    InternedName(const string& s) : index(pool().intern(s)) {}
+    InternedName(const char* s) : index(pool().intern(s)) {}
+    InternedName(string_view s) : index(pool().intern(s)) {}
+    
+    static InternedName fromId(int id) {
+        InternedName n;
+        n.index = id;
+        return n;
+    }
+    
+    // Look a name up without interning it; null if unknown
+    static InternedName lookup(string_view s) {
+        return fromId(pool().find(s));
+    }
+    
+    // Number of ids handed out so far (upper bound for dense arrays)
+    static int count() { return pool().size(); }
+    
+    int id() const { return index; }
+    bool isNull() const { return index < 0; }
+    
+    const string& str() const {
+        static const string empty;
+        return isNull() ? empty : pool().name(index);
+    }
+    
+    bool operator==(const InternedName& other) const { return index == other.index; }
+    bool operator!=(const InternedName& other) const { return index != other.index; }
+    bool operator<(const InternedName& other) const { return index < other.index; }
+    
+    friend ostream& operator<<(ostream& os, const InternedName& n) {
+        return os << n.str();
+    }
+};
+
+struct RegionTag {};
+struct PartyTag {};
+
+typedef InternedName<RegionTag> RegionName;
+typedef InternedName<PartyTag> PartyName;
+
+#endif // INTERN_H
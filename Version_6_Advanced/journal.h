@@ -0,0 +1,335 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// One journaled vote. Stored on disk as a fixed 28-byte little-endian
+// record: sequence, voterId, candidateId, voteTime, checksum.
+struct VoteRecord {
+    uint64_t sequence;
+    int32_t voterId;
+    int32_t candidateId;
+    int64_t voteTime;
+    
+    VoteRecord() : sequence(0), voterId(0), candidateId(0), voteTime(0) {}
+    VoteRecord(uint64_t seq, int vid, int cid, time_t when)
+        : sequence(seq), voterId(vid), candidateId(cid), voteTime(when) {}
+};
+
+// Append-only log of cast votes with group commit: one fsync per group,
+// after commitEvery votes, commitMillis, or at once for a waitDurable()
+// caller. Replay stops at the first torn or corrupt record. A failed
+// write or fsync puts the journal in an error state until reopened.
+class VoteJournal {
+private:
+    static const int RECORD_SIZE = 28;
+    static constexpr const char* MAGIC = "VMSJRNL1";
+    
+    FILE* file;
+    string path;
+    int commitEvery;
+    int commitMillis;
+    uint64_t nextSequence;
+    uint64_t durableSequence;
+    vector<unsigned char> pending;
+    int pendingCount;
+    
+    mutex lock;
+    condition_variable wake;        // flusher: votes pending or stopping
+    condition_variable committed;   // durableSequence moved or a commit ended
+    thread flusher;
+    bool stopping;
+    bool committing;                // a group is being written outside lock
+    bool failed;                    // a group did not reach the disk
+    int waiters;                    // threads in waitDurable
+    
+    static uint32_t checksum(const unsigned char* data, size_t n) {
+        uint32_t h = 2166136261u; // FNV-1a
+        for (size_t i = 0; i < n; i++) {
+            h = (h ^ data[i]) * 16777619u;
+        }
+        return h;
+    }
+    
+    static void put(unsigned char* out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) out[i] = (unsigned char)(value >> (8 * i));
+    }
+    
+    static uint64_t get(const unsigned char* in, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= (uint64_t)in[i] << (8 * i);
+        return value;
+    }
+    
+    static void encode(const VoteRecord& r, unsigned char* out) {
+        put(out, r.sequence, 8);
+        put(out + 8, (uint32_t)r.voterId, 4);
+        put(out + 12, (uint32_t)r.candidateId, 4);
+        put(out + 16, (uint64_t)r.voteTime, 8);
+        put(out + 24, checksum(out, 24), 4);
+    }
+    
+    static bool decode(const unsigned char* in, VoteRecord& r) {
+        if ((uint32_t)get(in + 24, 4) != checksum(in, 24)) return false;
+        r.sequence = get(in, 8);
+        r.voterId = (int32_t)(uint32_t)get(in + 8, 4);
+        r.candidateId = (int32_t)(uint32_t)get(in + 12, 4);
+        r.voteTime = (int64_t)get(in + 16, 8);
+        return true;
+    }
+    
+    static void truncateFile(FILE* f, long size) {
+        fflush(f);
+#ifdef _WIN32
+        _chsize(_fileno(f), size);
+#else
+        if (ftruncate(fileno(f), size) != 0) return;
+#endif
+    }
+    
+    static bool syncFile(FILE* f) {
+        if (fflush(f) != 0) return false;
+#ifdef _WIN32
+        return _commit(_fileno(f)) == 0;
+#else
+        return fsync(fileno(f)) == 0;
+#endif
+    }
+    
+    // Write and fsync the pending group outside the lock, one commit at a
+    // time so the file stays in sequence order. After a failure nothing
+    // more is written: the file may end in a partial group.
+    void commitPending(unique_lock<mutex>& guard) {
+        committed.wait(guard, [this] { return !committing; });
+        if (pendingCount == 0 || !file || failed) return;
+        
+        vector<unsigned char> group;
+        group.swap(pending);
+        uint64_t last = nextSequence - 1;
+        pendingCount = 0;
+        committing = true;
+        
+        guard.unlock();
+        bool written = fwrite(group.data(), 1, group.size(), file) == group.size()
+                       && syncFile(file);
+        guard.lock();
+        
+        committing = false;
+        if (written) {
+            durableSequence = last;
+        } else {
+            failed = true;
+        }
+        if (pending.empty()) {
+            group.clear();
+            pending.swap(group); // keep the capacity
+        }
+        committed.notify_all();
+    }
+    
+    void flushLoop() {
+        unique_lock<mutex> guard(lock);
+        while (!stopping) {
+            if (pendingCount == 0 || failed) {
+                wake.wait(guard);
+                continue;
+            }
+            wake.wait_for(guard, chrono::milliseconds(commitMillis), [this] {
+                return stopping || waiters > 0 || pendingCount >= commitEvery;
+            });
+            commitPending(guard);
+        }
+    }
+
+public:
+    // groupSize and groupMillis bound the groups of records nobody waits
+    // for. castVote and castVotes always wait, so on their path a group is
+    // whatever was appended while the previous fsync ran.
+    VoteJournal(int groupSize = 1000, int groupMillis = 10)
+        : file(nullptr), commitEvery(groupSize), commitMillis(groupMillis),
+          nextSequence(1), durableSequence(0), pendingCount(0), stopping(false),
+          committing(false), failed(false), waiters(0) {}
+    
+    ~VoteJournal() { close(); }
+    
+    // Open (or create, if missing or empty) a journal for appending;
+    // refuses a file that is not a journal
+    bool open(const string& filename) {
+        close();
+        
+        FILE* probe = fopen(filename.c_str(), "rb");
+        bool exists = false;
+        if (probe) {
+            exists = (fgetc(probe) != EOF);
+            fclose(probe);
+        }
+        
+        vector<VoteRecord> existing;
+        if (exists && !readAll(filename, existing)) {
+            return false;
+        }
+        
+        file = fopen(filename.c_str(), exists ? "r+b" : "wb");
+        if (!file) return false;
+        
+        if (exists) {
+            // Drop any torn tail so new records follow the last good one
+            long goodEnd = 8 + (long)existing.size() * RECORD_SIZE;
+            truncateFile(file, goodEnd);
+            fseek(file, goodEnd, SEEK_SET);
+            nextSequence = existing.empty() ? 1 : existing.back().sequence + 1;
+        } else {
+            if (fwrite(MAGIC, 1, 8, file) != 8 || !syncFile(file)) {
+                fclose(file);
+                file = nullptr;
+                return false;
+            }
+            nextSequence = 1;
+        }
+        durableSequence = nextSequence - 1;
+        failed = false;
+        path = filename;
+        
+        stopping = false;
+        flusher = thread(&VoteJournal::flushLoop, this);
+        return true;
+    }
+    
+    bool isOpen() const { return file != nullptr; }
+    const string& getPath() const { return path; }
+    
+    // True once a write or fsync has failed; votes since are not on disk
+    bool hasFailed() {
+        lock_guard<mutex> guard(lock);
+        return failed;
+    }
+    
+    // Buffer one vote; returns its sequence number (see waitDurable)
+    uint64_t append(int voterId, int candidateId, time_t when) {
+        lock_guard<mutex> guard(lock);
+        VoteRecord r(nextSequence++, voterId, candidateId, when);
+        
+        size_t at = pending.size();
+        pending.resize(at + RECORD_SIZE);
+        encode(r, pending.data() + at);
+        
+        // The first vote starts the commitMillis clock; a full group
+        // cuts it short
+        if (++pendingCount == 1 || pendingCount >= commitEvery) {
+            wake.notify_one();
+        }
+        return r.sequence;
+    }
+    
+    // Buffer several votes under one lock acquisition; returns the
+    // sequence number of the last one (0 if records is empty)
+    uint64_t appendBatch(const vector<VoteRecord>& records) {
+        if (records.empty()) return 0;
+        lock_guard<mutex> guard(lock);
+        
+        size_t at = pending.size();
+        pending.resize(at + records.size() * RECORD_SIZE);
+        for (const auto& record : records) {
+            VoteRecord r(nextSequence++, record.voterId, record.candidateId, (time_t)record.voteTime);
+            encode(r, pending.data() + at);
+            at += RECORD_SIZE;
+        }
+        
+        bool wasIdle = (pendingCount == 0);
+        pendingCount += records.size();
+        if (wasIdle || pendingCount >= commitEvery) {
+            wake.notify_one();
+        }
+        return nextSequence - 1;
+    }
+    
+    // Block until the record with this sequence number is on disk, the
+    // journal is closed, or a commit fails; true only in the first case
+    bool waitDurable(uint64_t sequence) {
+        unique_lock<mutex> guard(lock);
+        if (durableSequence < sequence && file && !failed) {
+            waiters++;
+            wake.notify_one();
+            committed.wait(guard, [&] {
+                return durableSequence >= sequence || !file || failed;
+            });
+            waiters--;
+        }
+        return durableSequence >= sequence;
+    }
+    
+    // Force the pending group to disk
+    void commit() {
+        unique_lock<mutex> guard(lock);
+        commitPending(guard);
+    }
+    
+    void close() {
+        if (flusher.joinable()) {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_one();
+            flusher.join();
+        }
+        unique_lock<mutex> guard(lock);
+        if (file) {
+            commitPending(guard);
+            fclose(file);
+            file = nullptr;
+            committed.notify_all();
+        }
+    }
+    
+    // Highest sequence number handed out so far
+    uint64_t getLastSequence() {
+        lock_guard<mutex> guard(lock);
+        return nextSequence - 1;
+    }
+    
+    // Highest sequence number known to be on disk
+    uint64_t getDurableSequence() {
+        lock_guard<mutex> guard(lock);
+        return durableSequence;
+    }
+    
+    // Read every intact record of a journal file; false if it is missing
+    // or not a journal
+    static bool readAll(const string& filename, vector<VoteRecord>& records) {
+        FILE* f = fopen(filename.c_str(), "rb");
+        if (!f) return false;
+        
+        char magic[8];
+        if (fread(magic, 1, 8, f) != 8 || memcmp(magic, MAGIC, 8) != 0) {
+            fclose(f);
+            return false;
+        }
+        
+        unsigned char buffer[RECORD_SIZE];
+        VoteRecord r;
+        while (fread(buffer, 1, RECORD_SIZE, f) == (size_t)RECORD_SIZE && decode(buffer, r)) {
+            records.push_back(r);
+        }
+        fclose(f);
+        return true;
+    }
+};
+
+#endif // JOURNAL_H
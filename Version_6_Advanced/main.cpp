@@ -105,6 +105,8 @@ void candidateManagementMenu(ElectionDatabase& db) {
                 
                 if (db.deleteCandidate(id)) {
                     cout << "Candidate deleted successfully!\n";
+                    // Nothing keeps candidate slots between menu actions
+                    db.compactCandidatesIfSparse();
                 } else {
                     cout << "Failed to delete candidate.\n";
                 }
@@ -117,7 +119,7 @@ void candidateManagementMenu(ElectionDatabase& db) {
                 ElectionUtils::clearInputBuffer();
                 getline(cin, region);
                 
-                auto candidates = db.getCandidatesByRegion(region);
+                auto candidates = db.getCandidatesByRegion(RegionName::lookup(region));
                 if (candidates.empty()) {
                     cout << "No candidates found in this region.\n";
                 } else {
@@ -136,7 +138,7 @@ void candidateManagementMenu(ElectionDatabase& db) {
                 ElectionUtils::clearInputBuffer();
                 getline(cin, party);
                 
-                auto candidates = db.getCandidatesByParty(party);
+                auto candidates = db.getCandidatesByParty(PartyName::lookup(party));
                 if (candidates.empty()) {
                     cout << "No candidates found for this party.\n";
                 } else {
@@ -212,7 +214,7 @@ void voterManagementMenu(ElectionDatabase& db) {
                 cout << "Enter Voter ID: ";
                 cin >> id;
                 
-                Voter* v = db.findVoter(id);
+                auto v = db.findVoter(id);
                 if (v) {
                     cout << "\n" << string(50, '=') << "\n";
                     cout << "Voter ID: " << v->id << "\n";
@@ -235,7 +237,7 @@ void voterManagementMenu(ElectionDatabase& db) {
                 cout << "Enter Voter ID: ";
                 cin >> id;
                 
-                Voter* v = db.findVoter(id);
+                auto v = db.findVoter(id);
                 if (v) {
                     if (v->hasVoted) {
                         cout << "Voter " << v->name << " has already voted.\n";
@@ -280,7 +282,7 @@ void votingOperationsMenu(ElectionDatabase& db) {
                 cout << "\nEnter Your Voter ID: ";
                 cin >> voterId;
                 
-                Voter* voter = db.findVoter(voterId);
+                auto voter = db.findVoter(voterId);
                 if (!voter) {
                     cout << "Voter ID not found!\n";
                     break;
@@ -385,7 +387,8 @@ void analyticsMenu(ElectionDatabase& db) {
         cout << "5. Predict Winner\n";
         cout << "6. Find Inactive Voters\n";
         cout << "7. Generate Comprehensive Report\n";
-        cout << "8. Back to Main Menu\n";
+        cout << "8. Set Age Brackets\n";
+        cout << "9. Back to Main Menu\n";
         cout << "Choice: ";
         
         int choice;
@@ -397,7 +400,7 @@ void analyticsMenu(ElectionDatabase& db) {
             continue;
         }
         
-        if (choice == 8) break;
+        if (choice == 9) break;
         
         switch (choice) {
             case 1:
@@ -428,13 +431,32 @@ void analyticsMenu(ElectionDatabase& db) {
                 analytics.generateComprehensiveReport();
                 break;
             
+            case 8: {
+                string line;
+                cout << "Enter ascending lower ages of each bracket (e.g. 18 26 36 51 66): ";
+                ElectionUtils::clearInputBuffer();
+                getline(cin, line);
+                
+                istringstream in(line);
+                vector<int> edges;
+                int edge;
+                while (in >> edge) edges.push_back(edge);
+                
+                if (analytics.setAgeBrackets(edges)) {
+                    cout << "Age brackets updated.\n";
+                } else {
+                    cout << "Invalid brackets: give at least one age, in increasing order.\n";
+                }
+                break;
+            }
+            
             default:
                 cout << "Invalid choice!\n";
         }
     }
 }
 
-void dataManagementMenu(ElectionDatabase& db) {
+void dataManagementMenu(ElectionDatabase& db, VoteJournal& journal) {
     while (true) {
         cout << "\n--- Data Management ---\n";
         cout << "1. Save Candidates to File\n";
@@ -442,7 +464,11 @@ void dataManagementMenu(ElectionDatabase& db) {
         cout << "3. Load Candidates from File\n";
         cout << "4. Load Voters from File\n";
         cout << "5. Export Results to CSV\n";
-        cout << "6. Back to Main Menu\n";
+        cout << "6. Start Vote Journal\n";
+        cout << "7. Replay Vote Journal\n";
+        cout << "8. Save Snapshot\n";
+        cout << "9. Load Snapshot\n";
+        cout << "10. Back to Main Menu\n";
         cout << "Choice: ";
         
         int choice;
@@ -454,7 +480,7 @@ void dataManagementMenu(ElectionDatabase& db) {
             continue;
         }
         
-        if (choice == 6) break;
+        if (choice == 10) break;
         
         string filename;
         ElectionUtils::clearInputBuffer();
@@ -490,6 +516,45 @@ void dataManagementMenu(ElectionDatabase& db) {
                 ElectionUtils::exportResultsToCSV(db, filename);
                 break;
             
+            case 6:
+                cout << "Enter journal filename: ";
+                getline(cin, filename);
+                if (journal.open(filename)) {
+                    db.attachJournal(&journal);
+                    cout << "Votes are now journaled to " << filename << "\n";
+                } else {
+                    cout << "Error: Could not open journal " << filename << "\n";
+                }
+                break;
+            
+            case 7: {
+                cout << "Enter journal filename: ";
+                getline(cin, filename);
+                int applied = db.replayJournal(filename);
+                if (applied < 0) {
+                    cout << "Error: Could not read journal " << filename << "\n";
+                } else {
+                    cout << "Replayed " << applied << " votes from " << filename << "\n";
+                }
+                break;
+            }
+            
+            case 8:
+                cout << "Enter snapshot filename: ";
+                getline(cin, filename);
+                ElectionUtils::saveSnapshot(db, filename);
+                break;
+            
+            case 9: {
+                string journalFile;
+                cout << "Enter snapshot filename: ";
+                getline(cin, filename);
+                cout << "Journal to replay after it (blank for none): ";
+                getline(cin, journalFile);
+                ElectionUtils::loadSnapshot(db, filename, journalFile);
+                break;
+            }
+            
             default:
                 cout << "Invalid choice!\n";
         }
@@ -503,7 +568,8 @@ void systemUtilitiesMenu(ElectionDatabase& db) {
         cout << "2. Simulate Voting\n";
         cout << "3. Validate Data\n";
         cout << "4. System Information\n";
-        cout << "5. Back to Main Menu\n";
+        cout << "5. Generate Large Dataset\n";
+        cout << "6. Back to Main Menu\n";
         cout << "Choice: ";
         
         int choice;
@@ -515,7 +581,7 @@ void systemUtilitiesMenu(ElectionDatabase& db) {
             continue;
         }
         
-        if (choice == 5) break;
+        if (choice == 6) break;
         
         switch (choice) {
             case 1: {
@@ -530,9 +596,15 @@ void systemUtilitiesMenu(ElectionDatabase& db) {
             
             case 2: {
                 int numVotes;
+                double skew;
+                unsigned long long seed;
                 cout << "Enter number of votes to simulate: ";
                 cin >> numVotes;
-                ElectionUtils::simulateVoting(db, numVotes);
+                cout << "Popularity skew (0 = uniform, 1 = Zipf): ";
+                cin >> skew;
+                cout << "Random seed: ";
+                cin >> seed;
+                ElectionUtils::simulateVoting(db, numVotes, skew, seed);
                 break;
             }
             
@@ -551,6 +623,49 @@ void systemUtilitiesMenu(ElectionDatabase& db) {
                 cout << string(60, '=') << "\n";
                 break;
             
+            case 5: {
+                DatasetSpec spec;
+                int output;
+                cout << "Number of voters: ";
+                cin >> spec.voters;
+                cout << "Number of candidates: ";
+                cin >> spec.candidates;
+                cout << "Number of regions: ";
+                cin >> spec.regions;
+                cout << "Number of parties: ";
+                cin >> spec.parties;
+                cout << "Region size skew (0 = equal, 1 = Zipf): ";
+                cin >> spec.regionSkew;
+                cout << "Random seed: ";
+                cin >> spec.seed;
+                cout << "Output (1 = this session, 2 = CSV files, 3 = snapshot): ";
+                cin >> output;
+                if (cin.fail()) {
+                    ElectionUtils::clearInputBuffer();
+                    cout << "Invalid input!\n";
+                    break;
+                }
+                
+                if (output == 1) {
+                    ElectionUtils::generateSampleData(db, spec);
+                } else if (output == 2) {
+                    string candidateFile, voterFile;
+                    cout << "Candidates file: ";
+                    cin >> candidateFile;
+                    cout << "Voters file: ";
+                    cin >> voterFile;
+                    ElectionUtils::generateDatasetFiles(spec, candidateFile, voterFile);
+                } else if (output == 3) {
+                    string filename;
+                    cout << "Snapshot file: ";
+                    cin >> filename;
+                    ElectionUtils::generateDatasetSnapshot(spec, filename);
+                } else {
+                    cout << "Invalid choice!\n";
+                }
+                break;
+            }
+            
             default:
                 cout << "Invalid choice!\n";
         }
@@ -559,6 +674,7 @@ void systemUtilitiesMenu(ElectionDatabase& db) {
 
 int main() {
     ElectionDatabase db;
+    VoteJournal journal;
     
     cout << "\n" << string(60, '*') << "\n";
     cout << "    WELCOME TO COMPLETE VOTING MANAGEMENT SYSTEM\n";
@@ -599,7 +715,7 @@ int main() {
                 break;
             
             case 6:
-                dataManagementMenu(db);
+                dataManagementMenu(db, journal);
                 break;
             
             case 7:
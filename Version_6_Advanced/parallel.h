@@ -0,0 +1,48 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+// Small fork-join helpers shared by the bulk loaders and analytics
+class ParallelUtils {
+public:
+    static unsigned defaultThreads() {
+        unsigned n = thread::hardware_concurrency();
+        return (n > 0) ? n : 1;
+    }
+    
+    // Run task(i) for every i in [0, count). Workers pull the next index
+    // from a shared counter, so uneven tasks still balance. threads == 0
+    // means one worker per hardware thread.
+    static void forEach(size_t count, const function<void(size_t)>& task,
+                        unsigned threads = 0) {
+        if (threads == 0) threads = defaultThreads();
+        threads = (unsigned)min<size_t>(threads, count);
+        
+        if (threads <= 1) {
+            for (size_t i = 0; i < count; i++) task(i);
+            return;
+        }
+        
+        atomic<size_t> nextIndex(0);
+        vector<thread> workers;
+        workers.reserve(threads);
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&]() {
+                size_t i;
+                while ((i = nextIndex.fetch_add(1)) < count) {
+                    task(i);
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+    }
+};
+
+#endif // PARALLEL_H
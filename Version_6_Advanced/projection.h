@@ -0,0 +1,164 @@
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include "view.h"
+#include "parallel.h"
+#include "rng.h"
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Result of OutcomeProjection::run. Candidate entries are indexed like
+// ElectionView::candidates, party entries by PartyName id. A trial that
+// ends in a k-way tie counts 1/k of a win for each tied side.
+struct ProjectionResult {
+    size_t trials;
+    vector<double> candidateWins;       // probability of finishing first overall
+    vector<double> candidateMeanVotes;  // projected final votes
+    vector<double> candidateVotesSpread;// their standard deviation
+    vector<double> partyWins;           // probability of the most votes overall
+    
+    ProjectionResult() : trials(0) {}
+    
+    // Half-width of the 95% interval of a probability estimated from trials
+    double winInterval(double p) const {
+        return (trials > 0) ? 1.96 * sqrt(p * (1.0 - p) / trials) : 0.0;
+    }
+};
+
+// Monte Carlo projection of the final result. Each trial completes the
+// election: in every region the voters who have not voted yet
+// (totalVoters - votesPolled) vote too, each choosing among the region's
+// candidates with the shares observed so far (uniformly when the region
+// has no votes yet). A region's remaining votes are one multinomial draw,
+// made as a chain of binomials, so a trial costs O(candidates) however
+// many voters are left.
+class OutcomeProjection {
+private:
+    struct RegionDraw {
+        int remaining;
+        vector<int> members;        // indexes into view.candidates
+        vector<double> chance;      // of member j among members j, j+1, ...
+    };
+    
+    // Share one trial's win equally among everyone on the top total
+    template <typename T>
+    static void splitWin(const vector<T>& totals, T best, vector<double>& wins) {
+        int tied = count(totals.begin(), totals.end(), best);
+        for (size_t i = 0; i < totals.size(); i++) {
+            if (totals[i] == best) wins[i] += 1.0 / tied;
+        }
+    }
+
+public:
+    static ProjectionResult run(const ElectionView& view, size_t trials,
+                                uint64_t seed = 12345, unsigned threads = 0) {
+        const vector<Candidate>& candidates = view.candidates;
+        size_t nc = candidates.size();
+        int partyCount = 0;
+        for (const auto& c : candidates) partyCount = max(partyCount, c.party.id() + 1);
+        
+        // Per region: who can still get votes, and with what chance
+        vector<RegionDraw> draws(view.regions.size());
+        for (size_t i = 0; i < nc; i++) {
+            draws[candidates[i].region.id()].members.push_back(i);
+        }
+        for (size_t r = 0; r < draws.size(); r++) {
+            RegionDraw& draw = draws[r];
+            draw.remaining = max(0, view.regions[r].totalVoters - view.regions[r].votesPolled);
+            double total = 0;
+            for (int i : draw.members) total += candidates[i].votes;
+            double mass = 1.0;
+            for (int i : draw.members) {
+                double share = (total > 0) ? candidates[i].votes / total : 1.0 / draw.members.size();
+                draw.chance.push_back((mass > share) ? share / mass : 1.0);
+                mass -= share;
+            }
+        }
+        draws.erase(remove_if(draws.begin(), draws.end(), [](const RegionDraw& d) {
+            return d.members.empty() || d.remaining == 0;
+        }), draws.end());
+        
+        // Trials run in fixed blocks, each with its own generator and tallies
+        const size_t block = 4096;
+        size_t blocks = (nc == 0) ? 0 : (trials + block - 1) / block;
+        struct Tally {
+            vector<double> wins, partyWins;
+            vector<double> sum, sumSquares;
+        };
+        vector<Tally> tallies(blocks);
+        
+        ParallelUtils::forEach(blocks, [&](size_t b) {
+            FastRng rng(seed, b);
+            Tally& tally = tallies[b];
+            tally.wins.assign(nc, 0.0);
+            tally.partyWins.assign(partyCount, 0.0);
+            tally.sum.assign(nc, 0.0);
+            tally.sumSquares.assign(nc, 0.0);
+            vector<int> finals(nc);
+            vector<long long> partyTotals(partyCount);
+            
+            size_t count = min(block, trials - b * block);
+            for (size_t t = 0; t < count; t++) {
+                for (size_t i = 0; i < nc; i++) finals[i] = candidates[i].votes;
+                
+                for (const RegionDraw& draw : draws) {
+                    int left = draw.remaining;
+                    size_t last = draw.members.size() - 1;
+                    for (size_t j = 0; j < last && left > 0; j++) {
+                        int k = rng.binomial(left, draw.chance[j]);
+                        finals[draw.members[j]] += k;
+                        left -= k;
+                    }
+                    finals[draw.members[last]] += left;
+                }
+                
+                int best = finals[0];
+                fill(partyTotals.begin(), partyTotals.end(), 0);
+                for (size_t i = 0; i < nc; i++) {
+                    best = max(best, finals[i]);
+                    partyTotals[candidates[i].party.id()] += finals[i];
+                    tally.sum[i] += finals[i];
+                    tally.sumSquares[i] += (double)finals[i] * finals[i];
+                }
+                splitWin(finals, best, tally.wins);
+                splitWin(partyTotals, *max_element(partyTotals.begin(), partyTotals.end()), tally.partyWins);
+            }
+        }, threads);
+        
+        ProjectionResult result;
+        result.trials = trials;
+        result.candidateWins.assign(nc, 0.0);
+        result.candidateMeanVotes.assign(nc, 0.0);
+        result.candidateVotesSpread.assign(nc, 0.0);
+        result.partyWins.assign(partyCount, 0.0);
+        if (trials == 0 || nc == 0) return result;
+        
+        for (const Tally& tally : tallies) {
+            for (size_t i = 0; i < nc; i++) {
+                result.candidateWins[i] += tally.wins[i];
+                result.candidateMeanVotes[i] += tally.sum[i];
+                result.candidateVotesSpread[i] += tally.sumSquares[i];
+            }
+            for (int p = 0; p < partyCount; p++) {
+                result.partyWins[p] += tally.partyWins[p];
+            }
+        }
+        for (size_t i = 0; i < nc; i++) {
+            double mean = result.candidateMeanVotes[i] / trials;
+            double variance = result.candidateVotesSpread[i] / trials - mean * mean;
+            result.candidateWins[i] /= trials;
+            result.candidateMeanVotes[i] = mean;
+            result.candidateVotesSpread[i] = (variance > 0) ? sqrt(variance) : 0.0;
+        }
+        for (int p = 0; p < partyCount; p++) {
+            result.partyWins[p] /= trials;
+        }
+        return result;
+    }
+};
+
+#endif // PROJECTION_H
@@ -0,0 +1,92 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Small, fast generator (xorshift128+) for simulations and synthetic
+// workloads. Parallel users give each block of work its own generator,
+// seeded from the run seed and the block number, so results do not
+// depend on the thread count.
+class FastRng {
+private:
+    uint64_t s0, s1;
+    double spareNormal;
+    bool hasSpare;
+    
+    static uint64_t splitmix(uint64_t& x) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    FastRng(uint64_t seed, uint64_t stream) : spareNormal(0), hasSpare(false) {
+        uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+        s0 = splitmix(x);
+        s1 = splitmix(x);
+    }
+    
+    uint64_t next() {
+        uint64_t a = s0, b = s1;
+        s0 = b;
+        a ^= a << 23;
+        s1 = a ^ b ^ (a >> 17) ^ (b >> 26);
+        return s1 + b;
+    }
+    
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    
+    // Uniform in [0, n)
+    size_t below(size_t n) { return (size_t)(uniform() * n); }
+    
+    // Standard normal (Marsaglia polar method)
+    double normal() {
+        if (hasSpare) {
+            hasSpare = false;
+            return spareNormal;
+        }
+        double u, v, s;
+        do {
+            u = 2.0 * uniform() - 1.0;
+            v = 2.0 * uniform() - 1.0;
+            s = u * u + v * v;
+        } while (s >= 1.0 || s == 0.0);
+        double scale = sqrt(-2.0 * log(s) / s);
+        spareNormal = v * scale;
+        hasSpare = true;
+        return u * scale;
+    }
+    
+    // Binomial(n, p). Exact (inversion, O(mean) steps) while the smaller
+    // of np and n(1 - p) is under 10, where the skew matters; normal
+    // approximation above that (the remaining roll of a region is usually
+    // thousands of voters)
+    int binomial(int n, double p) {
+        if (n <= 0 || p <= 0.0) return 0;
+        if (p >= 1.0) return n;
+        if (p > 0.5) return n - binomial(n, 1.0 - p);
+        if (n * p < 10.0) {
+            double q = 1.0 - p, ratio = p / q;
+            double f = pow(q, n);   // P(k = 0); >= e^-14 since np < 10, p <= 1/2
+            double u = uniform();
+            int k = 0;
+            while (u > f && k < n) {
+                u -= f;
+                k++;
+                f *= ratio * (n - k + 1) / k;
+            }
+            return k;
+        }
+        double k = n * p + sqrt(n * p * (1.0 - p)) * normal();
+        k = floor(k + 0.5);
+        return (k < 0) ? 0 : (k > n ? n : (int)k);
+    }
+};
+
+#endif // RNG_H
@@ -0,0 +1,580 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "database.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Read-only view of a whole file: mmap on POSIX, a plain read elsewhere
+// (or if mapping fails).
+class MappedFile {
+private:
+    const unsigned char* bytes;
+    size_t length;
+    vector<unsigned char> buffer;
+    bool mapped;
+
+public:
+    MappedFile() : bytes(nullptr), length(0), mapped(false) {}
+    ~MappedFile() { close(); }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool open(const string& filename) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+            flags |= MAP_POPULATE; // fault the pages in up front, in bulk
+#endif
+            void* p = mmap(nullptr, info.st_size, PROT_READ, flags, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, info.st_size, MADV_SEQUENTIAL);
+                bytes = (const unsigned char*)p;
+                length = info.st_size;
+                mapped = true;
+            }
+        }
+        ::close(fd);
+        if (mapped) return true;
+#endif
+        FILE* f = fopen(filename.c_str(), "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        buffer.resize(size > 0 ? size : 0);
+        size_t got = fread(buffer.data(), 1, buffer.size(), f);
+        fclose(f);
+        
+        bytes = buffer.data();
+        length = got;
+        return true;
+    }
+    
+    void close() {
+#ifndef _WIN32
+        if (mapped) munmap((void*)bytes, length);
+#endif
+        mapped = false;
+        bytes = nullptr;
+        length = 0;
+        buffer.clear();
+    }
+    
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Binary checkpoint of a whole ElectionDatabase: a header, then 8-byte
+// aligned blocks (length + raw column bytes) that load copies in bulk.
+// journalSequence is the last journaled vote it contains; replay after it.
+class ElectionSnapshot {
+private:
+    static constexpr const char* MAGIC = "VMSSNAP1";
+    static const uint32_t VERSION = 1;
+    
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t layout;
+        uint64_t journalSequence;
+        uint64_t payloadBytes;
+        uint64_t blockCount;
+        uint64_t checksum;
+    };
+    
+    // Byte order and the sizes of the types stored raw
+    static uint32_t layoutWord() {
+        const uint16_t probe = 1;
+        uint32_t little = *(const unsigned char*)&probe;
+        return (little << 24) | (uint32_t(sizeof(size_t)) << 16) |
+               (uint32_t(sizeof(time_t)) << 8) | uint32_t(sizeof(int));
+    }
+    
+    // Running 64-bit checksum of one block, four multiply lanes over
+    // 8-byte words. Fed in pieces of any size; n is the block's length.
+    class Fold {
+    private:
+        static constexpr uint64_t PRIME = 0x100000001b3ULL;
+        uint64_t lane[4];
+        unsigned char tail[32];
+        size_t tailBytes;
+        
+        void words(const unsigned char* p) {
+            for (int k = 0; k < 4; k++) {
+                uint64_t w;
+                memcpy(&w, p + 8 * k, 8);
+                lane[k] = (lane[k] ^ w) * PRIME;
+                lane[k] ^= lane[k] >> 29;
+            }
+        }
+    
+    public:
+        Fold(uint64_t h, uint64_t n) : tailBytes(0) {
+            lane[0] = h;
+            lane[1] = h ^ 0x9e3779b97f4a7c15ULL;
+            lane[2] = h + n;
+            lane[3] = ~h;
+        }
+        
+        void add(const unsigned char* p, size_t n) {
+            if (tailBytes > 0) {
+                size_t take = min(n, 32 - tailBytes);
+                memcpy(tail + tailBytes, p, take);
+                tailBytes += take;
+                p += take;
+                n -= take;
+                if (tailBytes < 32) return;
+                words(tail);
+                tailBytes = 0;
+            }
+            for (; n >= 32; p += 32, n -= 32) words(p);
+            memcpy(tail, p, n);
+            tailBytes = n;
+        }
+        
+        uint64_t finish() {
+            for (size_t i = 0; i < tailBytes; i++) {
+                lane[0] = (lane[0] ^ tail[i]) * PRIME;
+            }
+            return (lane[0] * 31 + lane[1]) * 31 + lane[2] * 7 + lane[3];
+        }
+    };
+    
+    static uint64_t fold(uint64_t h, const unsigned char* p, size_t n) {
+        Fold f(h, n);
+        f.add(p, n);
+        return f.finish();
+    }
+    
+    class Reader {
+    private:
+        const unsigned char* base;
+        size_t size;
+        size_t pos;
+    
+    public:
+        uint64_t blockCount;
+        uint64_t checksum;
+        
+        Reader(const unsigned char* data, size_t n, size_t start)
+            : base(data), size(n), pos(start), blockCount(0), checksum(0) {}
+        
+        bool block(const unsigned char*& data, uint64_t& bytes) {
+            if (size - pos < 8) return false;
+            memcpy(&bytes, base + pos, 8);
+            pos += 8;
+            uint64_t padded = bytes + (8 - bytes % 8) % 8;
+            if (bytes > size || padded > size - pos) return false;
+            
+            data = base + pos;
+            pos += padded;
+            checksum = fold(checksum ^ bytes, data, bytes);
+            blockCount++;
+            return true;
+        }
+        
+        bool scalar(uint64_t& value) {
+            const unsigned char* data;
+            uint64_t bytes;
+            if (!block(data, bytes) || bytes != sizeof(value)) return false;
+            memcpy(&value, data, sizeof(value));
+            return true;
+        }
+        
+        // Blocks are 8-byte aligned, so the bytes can be read as T directly
+        template <typename T>
+        bool column(vector<T>& out) {
+            const unsigned char* data;
+            uint64_t bytes;
+            if (!block(data, bytes) || bytes % sizeof(T) != 0) return false;
+            const T* first = (const T*)data;
+            out.assign(first, first + bytes / sizeof(T));
+            return true;
+        }
+        
+        bool strings(vector<string>& out) {
+            vector<uint64_t> offsets;
+            const unsigned char* chars;
+            uint64_t bytes;
+            if (!column(offsets) || !block(chars, bytes) || offsets.empty()) return false;
+            
+            out.clear();
+            out.reserve(offsets.size() - 1);
+            for (size_t i = 0; i + 1 < offsets.size(); i++) {
+                if (offsets[i] > offsets[i + 1] || offsets[i + 1] > bytes) return false;
+                out.emplace_back((const char*)chars + offsets[i], offsets[i + 1] - offsets[i]);
+            }
+            return true;
+        }
+    };
+
+public:
+    // Appends blocks to a snapshot being written. A block too large to
+    // hold in memory can be written in pieces: begin, piece..., end.
+    class Writer {
+    private:
+        FILE* file;
+        Fold current;
+        uint64_t currentBytes;
+    
+    public:
+        uint64_t payloadBytes;
+        uint64_t blockCount;
+        uint64_t checksum;
+        
+        explicit Writer(FILE* f)
+            : file(f), current(0, 0), currentBytes(0), payloadBytes(0), blockCount(0), checksum(0) {}
+        
+        void begin(uint64_t bytes) {
+            fwrite(&bytes, 8, 1, file);
+            current = Fold(checksum ^ bytes, bytes);
+            currentBytes = bytes;
+        }
+        
+        void piece(const void* data, size_t bytes) {
+            if (bytes == 0) return;
+            fwrite(data, 1, bytes, file);
+            current.add((const unsigned char*)data, bytes);
+        }
+        
+        void end() {
+            static const unsigned char zeros[8] = {};
+            size_t padding = (8 - currentBytes % 8) % 8;
+            fwrite(zeros, 1, padding, file);
+            checksum = current.finish();
+            payloadBytes += 8 + currentBytes + padding;
+            blockCount++;
+        }
+        
+        void block(const void* data, size_t bytes) {
+            begin(bytes);
+            piece(data, bytes);
+            end();
+        }
+        
+        void scalar(uint64_t value) { block(&value, sizeof(value)); }
+        
+        template <typename T>
+        void column(const vector<T>& values) {
+            block(values.data(), values.size() * sizeof(T));
+        }
+        
+        // Strings as an offsets column plus one character block
+        template <typename Get>
+        void strings(size_t count, Get get) {
+            vector<uint64_t> offsets(1, 0);
+            string chars;
+            for (size_t i = 0; i < count; i++) {
+                string_view s = get(i);
+                chars.append(s.data(), s.size());
+                offsets.push_back(chars.size());
+            }
+            column(offsets);
+            block(chars.data(), chars.size());
+        }
+    };
+    
+    // Write a snapshot whose blocks body(Writer&) appends, via a temporary
+    // file renamed into place
+    template <typename Body>
+    static bool write(const string& filename, uint64_t journalSequence, Body body) {
+        static_assert(sizeof(time_t) == 8, "snapshot stores 64-bit vote times");
+        
+        string temp = filename + ".tmp";
+        FILE* file = fopen(temp.c_str(), "wb");
+        if (!file) return false;
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        
+        Header header;
+        memset(&header, 0, sizeof(header));
+        fwrite(&header, sizeof(header), 1, file); // patched below
+        
+        Writer out(file);
+        body(out);
+        
+        memcpy(header.magic, MAGIC, 8);
+        header.version = VERSION;
+        header.layout = layoutWord();
+        header.journalSequence = journalSequence;
+        header.payloadBytes = out.payloadBytes;
+        header.blockCount = out.blockCount;
+        header.checksum = out.checksum;
+        fseek(file, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, file);
+        
+        fflush(file);
+#ifdef _WIN32
+        _commit(_fileno(file));
+#else
+        fsync(fileno(file));
+#endif
+        bool ok = !ferror(file);
+        fclose(file);
+        
+        if (!ok) {
+            remove(temp.c_str());
+            return false;
+        }
+#ifdef _WIN32
+        remove(filename.c_str());
+#endif
+        return rename(temp.c_str(), filename.c_str()) == 0;
+    }
+    
+    // Name pools, live candidates and regions: everything before the
+    // voter columns
+    static void writeHead(Writer& out, const vector<Candidate>& candidates,
+                          const vector<Region>& regions) {
+        out.strings(RegionName::count(), [](size_t i) {
+            return string_view(RegionName::fromId(i).str());
+        });
+        out.strings(PartyName::count(), [](size_t i) {
+            return string_view(PartyName::fromId(i).str());
+        });
+        
+        size_t nc = candidates.size();
+        vector<int> cIds(nc), cVotes(nc), cAges(nc), cParties(nc), cRegions(nc);
+        for (size_t i = 0; i < nc; i++) {
+            cIds[i] = candidates[i].id;
+            cVotes[i] = candidates[i].votes;
+            cAges[i] = candidates[i].age;
+            cParties[i] = candidates[i].party.id();
+            cRegions[i] = candidates[i].region.id();
+        }
+        out.column(cIds);
+        out.column(cVotes);
+        out.column(cAges);
+        out.column(cParties);
+        out.column(cRegions);
+        out.strings(nc, [&](size_t i) { return string_view(candidates[i].name); });
+        out.strings(nc, [&](size_t i) { return string_view(candidates[i].qualification); });
+        
+        vector<int> rNames, rTotals, rPolled;
+        vector<uint64_t> rOffsets(1, 0);
+        vector<int> rCandidates;
+        for (const auto& r : regions) {
+            rNames.push_back(r.name.id());
+            rTotals.push_back(r.totalVoters);
+            rPolled.push_back(r.votesPolled);
+            rCandidates.insert(rCandidates.end(), r.candidateIds.begin(), r.candidateIds.end());
+            rOffsets.push_back(rCandidates.size());
+        }
+        out.column(rNames);
+        out.column(rTotals);
+        out.column(rPolled);
+        out.column(rOffsets);
+        out.column(rCandidates);
+    }
+    
+    // The last section: the voter id index, so loading does not rehash
+    static void writeVoterIndex(Writer& out, const IdIndex& index) {
+        out.scalar(index.size());
+        out.column(index.rawKeys());
+        out.column(index.rawValues());
+    }
+    
+    // Write db to filename; votes may go on meanwhile. The vote columns
+    // and tallies come from one checkpoint, which also gives the journal
+    // sequence to record.
+    static bool save(const ElectionDatabase& db, const string& filename) {
+        ElectionDatabase::VoteCheckpoint state = db.checkpoint();
+        return write(filename, state.journalSequence, [&](Writer& out) {
+            writeHead(out, state.candidates, state.regions);
+            
+            // Columns castVote never writes straight from memory
+            const VoterTable& voters = *db.voters;
+            out.column(voters.ids);
+            out.column(voters.ages);
+            out.column(voters.regionIds);
+            out.scalar(state.voted.size());
+            out.column(state.voted.data());
+            out.column(state.votedFor);
+            out.column(state.voteTimes);
+            out.column(voters.nameOffsets);
+            out.column(voters.nameData);
+            
+            writeVoterIndex(out, db.voterIndex);
+        });
+    }
+    
+    // Replace db with a snapshot; db is untouched if the file is missing,
+    // from another build, corrupt or inconsistent
+    static bool load(ElectionDatabase& db, const string& filename,
+                     uint64_t& journalSequence) {
+        MappedFile file;
+        if (!file.open(filename) || file.size() < sizeof(Header)) {
+            return false;
+        }
+        
+        Header header;
+        memcpy(&header, file.data(), sizeof(header));
+        if (memcmp(header.magic, MAGIC, 8) != 0 || header.version != VERSION ||
+            header.layout != layoutWord() ||
+            header.payloadBytes != file.size() - sizeof(Header)) {
+            return false;
+        }
+        
+        Reader in(file.data(), file.size(), sizeof(Header));
+        
+        vector<string> regionNames, partyNames;
+        vector<int> cIds, cVotes, cAges, cParties, cRegions;
+        vector<string> cNames, cQualifications;
+        vector<int> rNames, rTotals, rPolled, rCandidates;
+        vector<uint64_t> rOffsets;
+        VoterTable voters;
+        uint64_t votedBits = 0, indexed = 0;
+        vector<uint64_t> votedWords;
+        vector<int> indexKeys, indexValues;
+        
+        bool ok = in.strings(regionNames) && in.strings(partyNames) &&
+                  in.column(cIds) && in.column(cVotes) && in.column(cAges) &&
+                  in.column(cParties) && in.column(cRegions) &&
+                  in.strings(cNames) && in.strings(cQualifications) &&
+                  in.column(rNames) && in.column(rTotals) && in.column(rPolled) &&
+                  in.column(rOffsets) && in.column(rCandidates) &&
+                  in.column(voters.ids) && in.column(voters.ages) &&
+                  in.column(voters.regionIds) && in.scalar(votedBits) &&
+                  in.column(votedWords) && in.column(voters.votedFor) &&
+                  in.column(voters.voteTimes) && in.column(voters.nameOffsets) &&
+                  in.column(voters.nameData) &&
+                  in.scalar(indexed) && in.column(indexKeys) && in.column(indexValues);
+        
+        if (!ok || in.blockCount != header.blockCount || in.checksum != header.checksum) {
+            return false;
+        }
+        
+        // Shape checks, so a well-formed but inconsistent file cannot
+        // index out of range later
+        size_t nc = cIds.size(), nr = rNames.size(), nv = voters.ids.size();
+        if (cVotes.size() != nc || cAges.size() != nc || cParties.size() != nc ||
+            cRegions.size() != nc || cNames.size() != nc || cQualifications.size() != nc ||
+            rTotals.size() != nr || rPolled.size() != nr || rOffsets.size() != nr + 1 ||
+            rOffsets[nr] != rCandidates.size() ||
+            voters.ages.size() != nv || voters.regionIds.size() != nv ||
+            voters.votedFor.size() != nv || voters.voteTimes.size() != nv ||
+            voters.nameOffsets.size() != nv + 1 || voters.nameOffsets[nv] != voters.nameData.size() ||
+            votedBits != nv || votedWords.size() != (nv + 63) / 64 ||
+            indexed != nv || indexKeys.size() != indexValues.size() ||
+            indexKeys.size() < 2 * nv || (indexKeys.size() & (indexKeys.size() - 1)) != 0) {
+            return false;
+        }
+        
+        // Re-intern the names; remap[stored id] = id in this process
+        vector<int> regionRemap(regionNames.size()), partyRemap(partyNames.size());
+        bool identity = true;
+        for (size_t i = 0; i < regionNames.size(); i++) {
+            regionRemap[i] = RegionName(regionNames[i]).id();
+            identity = identity && regionRemap[i] == (int)i;
+        }
+        for (size_t i = 0; i < partyNames.size(); i++) {
+            partyRemap[i] = PartyName(partyNames[i]).id();
+        }
+        
+        auto validId = [](int id, const vector<int>& remap) {
+            return id >= 0 && id < (int)remap.size();
+        };
+        for (size_t i = 0; i < nc; i++) {
+            if (!validId(cRegions[i], regionRemap) || !validId(cParties[i], partyRemap)) {
+                return false;
+            }
+        }
+        for (size_t r = 0; r < nr; r++) {
+            if (rNames[r] != -1 && !validId(rNames[r], regionRemap)) return false;
+            if (rOffsets[r] > rOffsets[r + 1]) return false;
+        }
+        for (int& id : voters.regionIds) {
+            if (!validId(id, regionRemap)) return false;
+            if (!identity) id = regionRemap[id];
+        }
+        
+        // Every candidate listed exactly once, by the region it names
+        IdIndex candidateIndex;
+        candidateIndex.reserve(nc);
+        for (size_t i = 0; i < nc; i++) {
+            if (!candidateIndex.insert(cIds[i], i)) return false;
+        }
+        vector<unsigned char> listed(nc, 0);
+        for (size_t r = 0; r < nr; r++) {
+            for (uint64_t k = rOffsets[r]; k < rOffsets[r + 1]; k++) {
+                int slot = candidateIndex.find(rCandidates[k]);
+                if (slot < 0 || listed[slot] || rNames[r] != cRegions[slot]) return false;
+                listed[slot] = 1;
+            }
+        }
+        if (count(listed.begin(), listed.end(), 0) != 0) return false;
+        
+        // Every voter in the id index once, under their own id
+        Bitmap indexedSlots(nv);
+        size_t used = 0;
+        for (size_t b = 0; b < indexKeys.size(); b++) {
+            int slot = indexValues[b];
+            if (slot < 0) continue;
+            if ((size_t)slot >= nv || indexedSlots.test(slot) ||
+                voters.ids[slot] != indexKeys[b]) {
+                return false;
+            }
+            indexedSlots.set(slot);
+            used++;
+        }
+        if (used != nv) return false;
+        
+        vector<Candidate> candidates(nc);
+        for (size_t i = 0; i < nc; i++) {
+            Candidate& c = candidates[i];
+            c.id = cIds[i];
+            c.votes = cVotes[i];
+            c.age = cAges[i];
+            c.party = PartyName::fromId(partyRemap[cParties[i]]);
+            c.region = RegionName::fromId(regionRemap[cRegions[i]]);
+            c.name = move(cNames[i]);
+            c.qualification = move(cQualifications[i]);
+        }
+        
+        vector<Region> regions(RegionName::count());
+        for (size_t r = 0; r < nr; r++) {
+            if (rNames[r] == -1) continue;
+            Region& region = regions[regionRemap[rNames[r]]];
+            region.name = RegionName::fromId(regionRemap[rNames[r]]);
+            region.totalVoters = rTotals[r];
+            region.votesPolled = rPolled[r];
+            region.candidateIds.assign(rCandidates.begin() + rOffsets[r],
+                                       rCandidates.begin() + rOffsets[r + 1]);
+        }
+        
+        voters.voted.assign(move(votedWords), nv);
+        
+        db.candidates = move(candidates);
+        db.candidateIndex = move(candidateIndex);
+        db.regions = move(regions);
+        db.voters = make_shared<VoterTable>(move(voters));
+        db.voterIndex.assignRaw(move(indexKeys), move(indexValues), indexed);
+        db.rebuildTallies();
+        
+        journalSequence = header.journalSequence;
+        return true;
+    }
+};
+
+#endif // SNAPSHOT_H
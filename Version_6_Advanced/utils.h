@@ -2,11 +2,18 @@
 #define UTILS_H
 
 #include "database.h"
+#include "csv.h"
+#include "parallel.h"
+#include "snapshot.h"
+#include "workload.h"
+#include "generator.h"
+#include "validation.h"
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
+#include <limits>
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <ctime>
 
@@ -25,12 +32,12 @@ public:
         file << "ID,Name,Party,Region,Votes,Age,Qualification\n";
         for (const auto& c : db.getAllCandidates()) {
             file << c.id << ","
-                 << c.name << ","
-                 << c.party << ","
-                 << c.region << ","
+                 << CsvReader::escape(c.name) << ","
+                 << CsvReader::escape(c.party.str()) << ","
+                 << CsvReader::escape(c.region.str()) << ","
                  << c.votes << ","
                  << c.age << ","
-                 << c.qualification << "\n";
+                 << CsvReader::escape(c.qualification) << "\n";
         }
         
         file.close();
@@ -46,13 +53,15 @@ public:
         }
         
         file << "ID,Name,Region,Age,HasVoted,VotedFor\n";
-        for (const auto& v : db.getAllVoters()) {
-            file << v.id << ","
-                 << v.name << ","
-                 << v.region << ","
-                 << v.age << ","
-                 << (v.hasVoted ? "1" : "0") << ","
-                 << v.votedFor << "\n";
+        const VoterTable& voters = db.getVoterTable();
+        // Vote columns are read atomically: votes may be cast meanwhile
+        for (size_t i = 0; i < voters.size(); i++) {
+            file << voters.ids[i] << ","
+                 << CsvReader::escape(voters.name(i)) << ","
+                 << CsvReader::escape(voters.region(i).str()) << ","
+                 << voters.ages[i] << ","
+                 << (voters.voted.testAtomic(i) ? "1" : "0") << ","
+                 << VoterTable::loadShared(voters.votedFor[i]) << "\n";
         }
         
         file.close();
@@ -62,227 +71,306 @@ public:
     
     // Load data from file
     static bool loadCandidatesFromFile(ElectionDatabase& db, const string& filename) {
-        ifstream file(filename);
-        if (!file.is_open()) {
+        vector<char> buffer;
+        if (!CsvReader::readFile(filename, buffer)) {
             cout << "Error: Could not open file " << filename << "\n";
             return false;
         }
         
-        string line;
-        getline(file, line); // Skip header
-        
-        int count = 0;
-        while (getline(file, line)) {
-            stringstream ss(line);
-            string item;
-            vector<string> tokens;
-            
-            while (getline(ss, item, ',')) {
-                tokens.push_back(item);
+        CsvReader reader(buffer.data(), buffer.data() + buffer.size());
+        vector<string_view> fields;
+        reader.next(fields); // Skip header
+        
+        vector<Candidate> rows;
+        vector<int> rowNumbers;
+        BulkLoadReport malformed;
+        while (reader.next(fields)) {
+            int lineNo = reader.lineNumber();
+            if (fields.size() < 7) {
+                malformed.rejected.push_back(RejectedRow(lineNo, 0, "expected 7 fields"));
+                continue;
             }
             
-            if (tokens.size() >= 7) {
-                Candidate c;
-                c.id = stoi(tokens[0]);
-                c.name = tokens[1];
-                c.party = tokens[2];
-                c.region = tokens[3];
-                c.votes = stoi(tokens[4]);
-                c.age = stoi(tokens[5]);
-                c.qualification = tokens[6];
-                
-                if (db.addCandidate(c)) {
-                    count++;
-                }
+            Candidate c;
+            if (!CsvReader::parseInt(fields[0], c.id) ||
+                !CsvReader::parseInt(fields[4], c.votes) ||
+                !CsvReader::parseInt(fields[5], c.age)) {
+                malformed.rejected.push_back(RejectedRow(lineNo, 0, "invalid number"));
+                continue;
             }
+            c.name.assign(fields[1]);
+            c.party = PartyName(fields[2]);
+            c.region = RegionName(fields[3]);
+            c.qualification.assign(fields[6]);
+            
+            rows.push_back(move(c));
+            rowNumbers.push_back(lineNo);
         }
         
-        file.close();
-        cout << "Loaded " << count << " candidates from " << filename << "\n";
+        BulkLoadReport report = db.addCandidatesBulk(move(rows), rowNumbers);
+        mergeRejected(report, malformed);
+        
+        cout << "Loaded " << report.accepted << " candidates from " << filename << "\n";
+        report.display();
         return true;
     }
     
-    static bool loadVotersFromFile(ElectionDatabase& db, const string& filename) {
-        ifstream file(filename);
-        if (!file.is_open()) {
+    // Files above this size are split into line-aligned chunks and
+    // parsed on a worker pool (threads == 0: one per hardware thread)
+    static const size_t PARALLEL_LOAD_CHUNK = 4 << 20;
+    
+    static bool loadVotersFromFile(ElectionDatabase& db, const string& filename,
+                                   unsigned threads = 0) {
+        vector<char> buffer;
+        if (!CsvReader::readFile(filename, buffer)) {
             cout << "Error: Could not open file " << filename << "\n";
             return false;
         }
         
-        string line;
-        getline(file, line); // Skip header
-        
-        int count = 0;
-        while (getline(file, line)) {
-            stringstream ss(line);
-            string item;
-            vector<string> tokens;
-            
-            while (getline(ss, item, ',')) {
-                tokens.push_back(item);
+        char* begin = buffer.data();
+        char* end = begin + buffer.size();
+        while (begin < end && *begin++ != '\n') {} // Skip header
+        
+        if (threads == 0) threads = ParallelUtils::defaultThreads();
+        size_t chunkCount = min<size_t>(threads * 4, 
+                                        (end - begin) / PARALLEL_LOAD_CHUNK + 1);
+        auto chunks = CsvReader::splitLines(begin, end, chunkCount);
+        
+        // Each chunk is parsed independently with chunk-relative line numbers
+        vector<vector<Voter>> chunkRows(chunks.size());
+        vector<vector<int>> chunkLines(chunks.size());
+        vector<BulkLoadReport> chunkMalformed(chunks.size());
+        vector<int> chunkLineCount(chunks.size());
+        
+        ParallelUtils::forEach(chunks.size(), [&](size_t i) {
+            CsvReader reader(chunks[i].first, chunks[i].second);
+            parseVoterRows(reader, chunkRows[i], chunkLines[i], chunkMalformed[i]);
+            chunkLineCount[i] = count(chunks[i].first, chunks[i].second, '\n');
+        }, threads);
+        
+        // Merge in file order so duplicate resolution matches a serial load
+        vector<Voter> rows;
+        vector<int> rowNumbers;
+        BulkLoadReport malformed;
+        size_t total = 0;
+        for (const auto& c : chunkRows) total += c.size();
+        rows.reserve(total);
+        rowNumbers.reserve(total);
+        
+        int lineBase = 1; // header
+        for (size_t i = 0; i < chunks.size(); i++) {
+            for (size_t r = 0; r < chunkRows[i].size(); r++) {
+                rows.push_back(move(chunkRows[i][r]));
+                rowNumbers.push_back(chunkLines[i][r] + lineBase);
             }
-            
-            if (tokens.size() >= 6) {
-                Voter v;
-                v.id = stoi(tokens[0]);
-                v.name = tokens[1];
-                v.region = tokens[2];
-                v.age = stoi(tokens[3]);
-                v.hasVoted = (tokens[4] == "1");
-                v.votedFor = stoi(tokens[5]);
-                
-                if (db.addVoter(v)) {
-                    count++;
-                }
+            for (auto& bad : chunkMalformed[i].rejected) {
+                bad.row += lineBase;
+                malformed.rejected.push_back(bad);
             }
+            vector<Voter>().swap(chunkRows[i]);
+            lineBase += chunkLineCount[i];
         }
         
-        file.close();
-        cout << "Loaded " << count << " voters from " << filename << "\n";
+        BulkLoadReport report = db.addVotersBulk(move(rows), rowNumbers);
+        mergeRejected(report, malformed);
+        
+        cout << "Loaded " << report.accepted << " voters from " << filename << "\n";
+        report.display();
         return true;
     }
     
-    // Generate sample data
-    static void generateSampleData(ElectionDatabase& db) {
-        srand(time(nullptr));
-        
-        vector<string> parties = {"Democratic Party", "Republican Party", 
-                                 "Independent", "Green Party", "Liberal Party"};
-        vector<string> regions = {"North District", "South District", 
-                                 "East District", "West District", "Central District"};
-        vector<string> qualifications = {"Graduate", "Post-Graduate", "PhD", 
-                                        "Professional", "Diploma"};
-        
-        vector<string> firstNames = {"John", "Jane", "Michael", "Sarah", "David",
-                                    "Emily", "Robert", "Lisa", "James", "Mary"};
-        vector<string> lastNames = {"Smith", "Johnson", "Williams", "Brown", "Jones",
-                                   "Garcia", "Miller", "Davis", "Rodriguez", "Martinez"};
-        
-        // Generate candidates
-        cout << "\nGenerating sample candidates...\n";
-        for (int i = 0; i < 25; i++) {
-            Candidate c;
-            c.id = 1000 + i;
-            c.name = firstNames[rand() % firstNames.size()] + " " + 
-                    lastNames[rand() % lastNames.size()];
-            c.party = parties[rand() % parties.size()];
-            c.region = regions[rand() % regions.size()];
-            c.age = 25 + rand() % 45; // 25-70 years
-            c.qualification = qualifications[rand() % qualifications.size()];
+    // Parse voter records from reader into rows; lineNumbers are the
+    // reader's line numbers for each accepted row
+    static void parseVoterRows(CsvReader& reader, vector<Voter>& rows,
+                               vector<int>& lineNumbers, BulkLoadReport& malformed) {
+        vector<string_view> fields;
+        while (reader.next(fields)) {
+            int lineNo = reader.lineNumber();
+            if (fields.size() < 6) {
+                malformed.rejected.push_back(RejectedRow(lineNo, 0, "expected 6 fields"));
+                continue;
+            }
             
-            db.addCandidate(c);
-        }
-        
-        // Generate voters
-        cout << "Generating sample voters...\n";
-        for (int i = 0; i < 100; i++) {
             Voter v;
-            v.id = 5000 + i;
-            v.name = firstNames[rand() % firstNames.size()] + " " + 
-                    lastNames[rand() % lastNames.size()];
-            v.region = regions[rand() % regions.size()];
-            v.age = 18 + rand() % 62; // 18-80 years
+            if (!CsvReader::parseInt(fields[0], v.id) ||
+                !CsvReader::parseInt(fields[3], v.age) ||
+                !CsvReader::parseInt(fields[5], v.votedFor)) {
+                malformed.rejected.push_back(RejectedRow(lineNo, 0, "invalid number"));
+                continue;
+            }
+            v.name.assign(fields[1]);
+            v.region = RegionName(fields[2]);
+            v.hasVoted = (fields[4] == "1");
             
-            db.addVoter(v);
+            rows.push_back(move(v));
+            lineNumbers.push_back(lineNo);
+        }
+    }
+    
+    // Fold parse-level rejects into a bulk load report, ordered by row
+    static void mergeRejected(BulkLoadReport& report, const BulkLoadReport& malformed) {
+        report.rejected.insert(report.rejected.end(), 
+                               malformed.rejected.begin(), malformed.rejected.end());
+        sort(report.rejected.begin(), report.rejected.end(),
+             [](const RejectedRow& a, const RejectedRow& b) {
+                 return a.row < b.row;
+             });
+    }
+    
+    // Checkpoint the whole database to a binary snapshot. If a journal is
+    // attached the snapshot records the last journaled vote it contains.
+    static bool saveSnapshot(const ElectionDatabase& db, const string& filename) {
+        if (!ElectionSnapshot::save(db, filename)) {
+            cout << "Error: Could not write snapshot " << filename << "\n";
+            return false;
+        }
+        cout << "Snapshot saved to " << filename << "\n";
+        return true;
+    }
+    
+    // Restore a snapshot, then (if journalFile is given) replay the
+    // journaled votes recorded after it
+    static bool loadSnapshot(ElectionDatabase& db, const string& filename,
+                             const string& journalFile = "") {
+        auto start = chrono::steady_clock::now();
+        uint64_t sequence = 0;
+        if (!ElectionSnapshot::load(db, filename, sequence)) {
+            cout << "Error: " << filename << " is missing, corrupt, or not a snapshot\n";
+            return false;
+        }
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now() - start).count();
+        cout << "Loaded " << db.getCandidateCount() << " candidates and " 
+             << db.getVoterCount() << " voters from " << filename 
+             << " in " << elapsed << " ms\n";
+        
+        if (!journalFile.empty()) {
+            int applied = db.replayJournal(journalFile, sequence);
+            if (applied < 0) {
+                cout << "Error: Could not read journal " << journalFile << "\n";
+                return false;
+            }
+            cout << "Replayed " << applied << " votes from " << journalFile << "\n";
+        }
+        return true;
+    }
+    
+    // Generate a synthetic election (see DatasetGenerator) into db; the
+    // default spec is the small sample election
+    static bool generateSampleData(ElectionDatabase& db, const DatasetSpec& spec = DatasetSpec()) {
+        string problem = DatasetGenerator::checkSpec(spec);
+        if (!problem.empty()) {
+            cout << "Error: " << problem << ".\n";
+            return false;
         }
         
-        cout << "Sample data generated successfully!\n";
-        cout << "25 candidates and 100 voters created.\n";
+        cout << "\nGenerating " << spec.candidates << " candidates and " 
+             << spec.voters << " voters...\n";
+        auto start = chrono::steady_clock::now();
+        BulkLoadReport candidateReport, voterReport;
+        DatasetGenerator(spec).load(db, candidateReport, voterReport);
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now() - start).count();
+        
+        cout << "Sample data generated successfully in " << elapsed << " ms!\n";
+        if (!candidateReport.rejected.empty() || !voterReport.rejected.empty()) {
+            cout << "Skipped " << candidateReport.rejected.size() << " candidates and " 
+                 << voterReport.rejected.size() << " voters whose IDs already exist.\n";
+        }
+        cout << db.getCandidateCount() << " candidates and " 
+             << db.getVoterCount() << " voters in the system.\n";
+        return true;
     }
     
-    // Simulate voting
-    static void simulateVoting(ElectionDatabase& db, int numVotes) {
-        srand(time(nullptr));
+    // Write a synthetic election straight to CSV files (readable by
+    // loadCandidatesFromFile / loadVotersFromFile) without loading it
+    static bool generateDatasetFiles(const DatasetSpec& spec, const string& candidateFile,
+                                     const string& voterFile) {
+        string problem = DatasetGenerator::checkSpec(spec);
+        if (!problem.empty()) {
+            cout << "Error: " << problem << ".\n";
+            return false;
+        }
         
-        const auto& voters = db.getAllVoters();
-        const auto& candidates = db.getAllCandidates();
+        auto start = chrono::steady_clock::now();
+        if (!DatasetGenerator(spec).writeCsv(candidateFile, voterFile)) {
+            cout << "Error: Could not write " << candidateFile << " or " << voterFile << "\n";
+            return false;
+        }
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now() - start).count();
+        cout << "Wrote " << spec.candidates << " candidates to " << candidateFile 
+             << " and " << spec.voters << " voters to " << voterFile 
+             << " in " << elapsed << " ms\n";
+        return true;
+    }
+    
+    // Write a synthetic election straight to a snapshot file
+    static bool generateDatasetSnapshot(const DatasetSpec& spec, const string& filename) {
+        string problem = DatasetGenerator::checkSpec(spec);
+        if (!problem.empty()) {
+            cout << "Error: " << problem << ".\n";
+            return false;
+        }
         
-        if (voters.empty() || candidates.empty()) {
+        auto start = chrono::steady_clock::now();
+        if (!DatasetGenerator(spec).writeSnapshot(filename)) {
+            cout << "Error: Could not write snapshot " << filename << "\n";
+            return false;
+        }
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now() - start).count();
+        cout << "Wrote " << spec.candidates << " candidates and " << spec.voters 
+             << " voters to snapshot " << filename << " in " << elapsed << " ms\n";
+        return true;
+    }
+    
+    // Simulate voting: numVotes distinct voters who have not voted yet
+    // each vote in their region, favouring candidates by a Zipf law of
+    // exponent skew (0 = uniform). The same seed gives the same votes.
+    static void simulateVoting(ElectionDatabase& db, int numVotes, 
+                               double skew = 0.0, uint64_t seed = 12345) {
+        if (db.getVoterCount() == 0 || db.getCandidateCount() == 0) {
             cout << "Error: No voters or candidates available.\n";
             return;
         }
         
-        int successfulVotes = 0;
-        int attempts = 0;
-        
-        while (successfulVotes < numVotes && attempts < numVotes * 3) {
-            int voterIdx = rand() % voters.size();
-            const Voter& voter = voters[voterIdx];
-            
-            if (!voter.hasVoted) {
-                // Find candidates in same region
-                vector<int> candidatesInRegion;
-                for (const auto& c : candidates) {
-                    if (c.region == voter.region) {
-                        candidatesInRegion.push_back(c.id);
-                    }
-                }
-                
-                if (!candidatesInRegion.empty()) {
-                    int candidateId = candidatesInRegion[rand() % candidatesInRegion.size()];
-                    
-                    if (db.castVote(voter.id, candidateId)) {
-                        successfulVotes++;
-                    }
-                }
-            }
-            attempts++;
-        }
+        WorkloadOptions options;
+        options.seed = seed;
+        options.skew = skew;
+        WorkloadResult result = VoteWorkload::run(db, max(0, numVotes), options);
         
-        cout << "\nSimulation complete: " << successfulVotes 
+        cout << "\nSimulation complete: " << result.accepted 
              << " votes cast successfully.\n";
+        if (result.generated < result.requested) {
+            cout << "Only " << result.generated 
+                 << " voters were left who could still vote.\n";
+        }
+        cout << fixed << setprecision(1) 
+             << "Generated in " << result.generateMs << " ms, cast in " 
+             << result.castMs << " ms (" << setprecision(0) 
+             << result.votesPerSecond() << " votes/s).\n";
     }
     
-    // Data validation
-    static void validateData(const ElectionDatabase& db) {
+    // Data validation (see DataValidator); the report is returned too
+    static ValidationReport validateData(const ElectionDatabase& db) {
         cout << "\n" << string(70, '=') << "\n";
         cout << "           DATA VALIDATION REPORT\n";
         cout << string(70, '=') << "\n";
         
-        int issues = 0;
-        
-        // Check for duplicate IDs
-        set<int> candidateIds;
-        for (const auto& c : db.getAllCandidates()) {
-            if (candidateIds.count(c.id)) {
-                cout << "Warning: Duplicate candidate ID found: " << c.id << "\n";
-                issues++;
-            }
-            candidateIds.insert(c.id);
-        }
+        ValidationReport report = DataValidator::run(db);
+        cout << "Checked " << report.candidatesChecked << " candidates and " 
+             << report.votersChecked << " voters in " << fixed << setprecision(1) 
+             << report.elapsedMs << " ms\n\n";
         
-        set<int> voterIds;
-        for (const auto& v : db.getAllVoters()) {
-            if (voterIds.count(v.id)) {
-                cout << "Warning: Duplicate voter ID found: " << v.id << "\n";
-                issues++;
-            }
-            voterIds.insert(v.id);
-        }
-        
-        // Check for invalid ages
-        for (const auto& c : db.getAllCandidates()) {
-            if (c.age < 25 || c.age > 100) {
-                cout << "Warning: Invalid candidate age: " << c.name 
-                     << " (Age: " << c.age << ")\n";
-                issues++;
-            }
-        }
-        
-        for (const auto& v : db.getAllVoters()) {
-            if (v.age < 18 || v.age > 120) {
-                cout << "Warning: Invalid voter age: " << v.name 
-                     << " (Age: " << v.age << ")\n";
-                issues++;
-            }
-        }
-        
-        if (issues == 0) {
+        if (report.clean()) {
             cout << "All data validated successfully. No issues found.\n";
         } else {
-            cout << "\nTotal issues found: " << issues << "\n";
+            report.display();
+            cout << "\nTotal issues found: " << report.total() << "\n";
         }
         cout << string(70, '=') << "\n";
+        return report;
     }
     
     // Clear input buffer
@@ -316,12 +404,8 @@ public:
             return false;
         }
         
-        // Get sorted candidates
-        vector<Candidate> sorted = db.getAllCandidates();
-        sort(sorted.begin(), sorted.end(),
-             [](const Candidate& a, const Candidate& b) {
-                 return a.votes > b.votes;
-             });
+        // Ranked candidates, read in place
+        CandidateSlice sorted = db.getRanking();
         
         int totalVotes = 0;
         for (const auto& c : sorted) {
@@ -0,0 +1,407 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include "database.h"
+#include "idindex.h"
+#include "parallel.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <climits>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VALIDATION_SSE2
+#endif
+
+using namespace std;
+
+enum class IssueKind : unsigned char {
+    DuplicateCandidateId,
+    CandidateAge,
+    DuplicateVoterId,
+    VoterAge,
+    UnknownVotedFor,        // voted for a candidate that does not exist
+    WrongRegionVote,        // voted for a candidate of another region
+    VotedForWithoutVote,    // not voted, yet records a candidate
+    CandidateVoteCount,     // stored votes differ from the voters' records
+    RegionVoterCount        // stored roll size differs from the voters'
+};
+
+const int ISSUE_KIND_COUNT = 9;
+
+inline const char* issueKindName(IssueKind kind) {
+    switch (kind) {
+        case IssueKind::DuplicateCandidateId: return "Duplicate candidate ID";
+        case IssueKind::CandidateAge:         return "Invalid candidate age";
+        case IssueKind::DuplicateVoterId:     return "Duplicate voter ID";
+        case IssueKind::VoterAge:             return "Invalid voter age";
+        case IssueKind::UnknownVotedFor:      return "Vote for unknown candidate";
+        case IssueKind::WrongRegionVote:      return "Vote outside voter's region";
+        case IssueKind::VotedForWithoutVote:  return "Candidate recorded without a vote";
+        case IssueKind::CandidateVoteCount:   return "Candidate vote count mismatch";
+        case IssueKind::RegionVoterCount:     return "Region voter count mismatch";
+    }
+    return "Unknown issue";
+}
+
+// One problem found by DataValidator. id is the candidate or voter id
+// (a RegionName id for RegionVoterCount); value is the offending value
+// (age, recorded candidate, occurrences, stored count) and expected the
+// count the voter records imply, where that applies.
+struct ValidationIssue {
+    IssueKind kind;
+    int id;
+    int value;
+    int expected;
+    
+    ValidationIssue(IssueKind k, int i, int v, int e = 0)
+        : kind(k), id(i), value(v), expected(e) {}
+    
+    string describe() const {
+        switch (kind) {
+            case IssueKind::DuplicateCandidateId:
+                return "candidate ID " + to_string(id) + " appears " + to_string(value) + " times";
+            case IssueKind::DuplicateVoterId:
+                return "voter ID " + to_string(id) + " appears " + to_string(value) + " times";
+            case IssueKind::CandidateAge:
+                return "candidate " + to_string(id) + " (Age: " + to_string(value) + ")";
+            case IssueKind::VoterAge:
+                return "voter " + to_string(id) + " (Age: " + to_string(value) + ")";
+            case IssueKind::UnknownVotedFor:
+            case IssueKind::WrongRegionVote:
+            case IssueKind::VotedForWithoutVote:
+                return "voter " + to_string(id) + " -> candidate " + to_string(value);
+            case IssueKind::CandidateVoteCount:
+                return "candidate " + to_string(id) + " has " + to_string(value) +
+                       " votes, voters record " + to_string(expected);
+            case IssueKind::RegionVoterCount:
+                return RegionName::fromId(id).str() + " has " + to_string(value) +
+                       " voters, roll holds " + to_string(expected);
+        }
+        return "";
+    }
+};
+
+// Outcome of DataValidator::run. counts are exact; issues keeps at most
+// the first maxIssuesPerKind of each kind, grouped by kind.
+struct ValidationReport {
+    vector<ValidationIssue> issues;
+    size_t counts[ISSUE_KIND_COUNT];
+    size_t candidatesChecked;
+    size_t votersChecked;
+    double elapsedMs;
+    
+    ValidationReport() : candidatesChecked(0), votersChecked(0), elapsedMs(0) {
+        fill(counts, counts + ISSUE_KIND_COUNT, 0);
+    }
+    
+    size_t count(IssueKind kind) const { return counts[(int)kind]; }
+    
+    size_t total() const {
+        size_t sum = 0;
+        for (size_t c : counts) sum += c;
+        return sum;
+    }
+    
+    bool clean() const { return total() == 0; }
+    
+    void display(size_t maxRows = 10) const {
+        for (int k = 0; k < ISSUE_KIND_COUNT; k++) {
+            if (counts[k] == 0) continue;
+            IssueKind kind = (IssueKind)k;
+            cout << "Warning: " << issueKindName(kind) << ": " << counts[k] << "\n";
+            size_t shown = 0;
+            for (const auto& issue : issues) {
+                if (issue.kind != kind) continue;
+                if (shown++ == maxRows) break;
+                cout << "  " << issue.describe() << "\n";
+            }
+            if (counts[k] > maxRows) {
+                cout << "  ... and " << (counts[k] - maxRows) << " more\n";
+            }
+        }
+    }
+};
+
+// Parallel consistency check of a whole ElectionDatabase, meant for rolls
+// of tens of millions of voters. Must not run concurrently with voting.
+//
+// Voters are checked in 64K blocks on the worker pool: ages against the
+// allowed range (64 voters per SSE2 sweep; only a sweep that finds one
+// out of range is looked at voter by voter), votedFor against a local
+// candidate id -> region index, and votes and roll sizes recounted from
+// the voters' own records. Duplicate voter ids are found by hash
+// partitioning: the ids are scattered into 256 partitions by hash, then
+// every partition is checked with its own small table, which stays in
+// cache, with no allocation per voter.
+class DataValidator {
+private:
+    static constexpr size_t PARTITIONS = 256;
+    static constexpr size_t BLOCK = 1 << 16;    // a multiple of 64
+    
+    static uint32_t mix(int id) {
+        uint32_t x = (uint32_t)id;
+        x ^= x >> 16;
+        x *= 0x45d9f3bu;
+        x ^= x >> 16;
+        x *= 0x45d9f3bu;
+        x ^= x >> 16;
+        return x;
+    }
+    
+    // Issues of one block, capped per kind but counted in full
+    struct Findings {
+        vector<ValidationIssue> issues;
+        size_t counts[ISSUE_KIND_COUNT];
+        
+        Findings() { fill(counts, counts + ISSUE_KIND_COUNT, 0); }
+        
+        void add(const ValidationIssue& issue, size_t cap) {
+            if (counts[(int)issue.kind]++ < cap) issues.push_back(issue);
+        }
+    };
+    
+    // Add the slots in [begin, end) whose age lies outside [low, high]
+    static void ageOutliers(const int* ages, size_t begin, size_t end,
+                            int low, int high, vector<int>& out) {
+        size_t i = begin;
+#ifdef VALIDATION_SSE2
+        const __m128i below = _mm_set1_epi32(low), above = _mm_set1_epi32(high);
+        for (; i + 64 <= end; i += 64) {
+            __m128i bad = _mm_setzero_si128();
+            for (size_t j = 0; j < 64; j += 4) {
+                __m128i age = _mm_loadu_si128((const __m128i*)(ages + i + j));
+                bad = _mm_or_si128(bad, _mm_or_si128(_mm_cmplt_epi32(age, below),
+                                                     _mm_cmpgt_epi32(age, above)));
+            }
+            if (_mm_movemask_epi8(bad) == 0) continue;
+            for (size_t j = i; j < i + 64; j++) {
+                if (ages[j] < low || ages[j] > high) out.push_back(j);
+            }
+        }
+#endif
+        for (; i < end; i++) {
+            if (ages[i] < low || ages[i] > high) out.push_back(i);
+        }
+    }
+    
+    // Report every id occurring more than once, once, with its count
+    static void duplicateIds(const vector<int>& ids, size_t cap, unsigned threads,
+                             Findings& out) {
+        size_t n = ids.size();
+        size_t blocks = (n + BLOCK - 1) / BLOCK;
+        
+        // Scatter the ids into partitions by the top bits of their hash
+        vector<size_t> offsets(blocks * PARTITIONS, 0);
+        ParallelUtils::forEach(blocks, [&](size_t b) {
+            size_t* mine = &offsets[b * PARTITIONS];
+            for (size_t i = b * BLOCK; i < min(n, (b + 1) * BLOCK); i++) {
+                mine[mix(ids[i]) >> 24]++;
+            }
+        }, threads);
+        
+        vector<size_t> partitionStart(PARTITIONS + 1, 0);
+        size_t at = 0;
+        for (size_t p = 0; p < PARTITIONS; p++) {
+            partitionStart[p] = at;
+            for (size_t b = 0; b < blocks; b++) {
+                size_t count = offsets[b * PARTITIONS + p];
+                offsets[b * PARTITIONS + p] = at;
+                at += count;
+            }
+        }
+        partitionStart[PARTITIONS] = at;
+        
+        vector<int> scattered(n);
+        ParallelUtils::forEach(blocks, [&](size_t b) {
+            size_t* next = &offsets[b * PARTITIONS];
+            for (size_t i = b * BLOCK; i < min(n, (b + 1) * BLOCK); i++) {
+                scattered[next[mix(ids[i]) >> 24]++] = ids[i];
+            }
+        }, threads);
+        
+        // Each partition inserts its ids into a keys-only open-addressing
+        // table (INT_MIN marks an empty bucket, so that id is counted on the
+        // side); an id already present goes on the partition's repeat list
+        vector<vector<pair<int, int>>> repeated(PARTITIONS);
+        ParallelUtils::forEach(PARTITIONS, [&](size_t p) {
+            size_t size = partitionStart[p + 1] - partitionStart[p];
+            size_t capacity = 16;
+            while (capacity < size * 2) capacity *= 2;
+            vector<int> keys(capacity, INT_MIN);
+            vector<int> repeats;
+            int emptyKeyCount = 0;
+            
+            for (size_t i = partitionStart[p]; i < partitionStart[p + 1]; i++) {
+                int id = scattered[i];
+                if (id == INT_MIN) {
+                    if (emptyKeyCount++ > 0) repeats.push_back(id);
+                    continue;
+                }
+                size_t slot = mix(id) & (capacity - 1);
+                while (keys[slot] != INT_MIN && keys[slot] != id) slot = (slot + 1) & (capacity - 1);
+                if (keys[slot] == id) {
+                    repeats.push_back(id);
+                } else {
+                    keys[slot] = id;
+                }
+            }
+            
+            // k extra copies of an id mean k + 1 occurrences
+            sort(repeats.begin(), repeats.end());
+            for (size_t i = 0; i < repeats.size(); ) {
+                size_t j = i;
+                while (j < repeats.size() && repeats[j] == repeats[i]) j++;
+                repeated[p].push_back(make_pair(repeats[i], (int)(j - i) + 1));
+                i = j;
+            }
+        }, threads);
+        
+        vector<pair<int, int>> all;
+        for (const auto& r : repeated) all.insert(all.end(), r.begin(), r.end());
+        sort(all.begin(), all.end());
+        for (const auto& entry : all) {
+            out.add(ValidationIssue(IssueKind::DuplicateVoterId, entry.first, entry.second), cap);
+        }
+    }
+
+public:
+    static const int MIN_CANDIDATE_AGE = 25;
+    static const int MAX_CANDIDATE_AGE = 100;
+    static const int MIN_VOTER_AGE = 18;
+    static const int MAX_VOTER_AGE = 120;
+    
+    static ValidationReport run(const ElectionDatabase& db, size_t maxIssuesPerKind = 1000,
+                                unsigned threads = 0) {
+        auto start = chrono::steady_clock::now();
+        size_t cap = maxIssuesPerKind;
+        
+        // Candidates (few): duplicates, ages, and id -> index for the voters
+        vector<Candidate> candidates = db.getAllCandidates().toVector();
+        size_t nc = candidates.size();
+        Findings candidateFindings;
+        IdIndex candidateIndex;
+        candidateIndex.reserve(nc);
+        vector<int> occurrences(nc, 1);
+        for (size_t i = 0; i < nc; i++) {
+            const Candidate& c = candidates[i];
+            int first = candidateIndex.find(c.id);
+            if (first >= 0) {
+                occurrences[first]++;
+            } else {
+                candidateIndex.insert(c.id, i);
+            }
+        }
+        for (size_t i = 0; i < nc; i++) {
+            const Candidate& c = candidates[i];
+            if (occurrences[i] > 1) {
+                candidateFindings.add(ValidationIssue(IssueKind::DuplicateCandidateId,
+                                                      c.id, occurrences[i]), cap);
+            }
+            if (c.age < MIN_CANDIDATE_AGE || c.age > MAX_CANDIDATE_AGE) {
+                candidateFindings.add(ValidationIssue(IssueKind::CandidateAge, c.id, c.age), cap);
+            }
+        }
+        
+        // Voters, block by block
+        const VoterTable& voters = db.getVoterTable();
+        const vector<Region>& regions = db.getAllRegions();
+        size_t nv = voters.size();
+        size_t nr = regions.size();
+        size_t blocks = (nv + BLOCK - 1) / BLOCK;
+        vector<Findings> blockFindings(blocks);
+        vector<vector<int>> blockVotes(blocks), blockRoll(blocks);
+        
+        ParallelUtils::forEach(blocks, [&](size_t b) {
+            Findings& found = blockFindings[b];
+            size_t begin = b * BLOCK, end = min(nv, (b + 1) * BLOCK);
+            
+            vector<int> outliers;
+            ageOutliers(voters.ages.data(), begin, end, MIN_VOTER_AGE, MAX_VOTER_AGE, outliers);
+            for (int i : outliers) {
+                found.add(ValidationIssue(IssueKind::VoterAge, voters.ids[i], voters.ages[i]), cap);
+            }
+            
+            vector<int>& votes = blockVotes[b];
+            vector<int>& roll = blockRoll[b];
+            votes.assign(nc, 0);
+            roll.assign(nr, 0);
+            for (size_t i = begin; i < end; i++) {
+                int region = voters.regionIds[i];
+                if (region >= 0 && region < (int)nr) roll[region]++;
+                
+                int choice = voters.votedFor[i];
+                if (!voters.voted.test(i)) {
+                    if (choice != -1) {
+                        found.add(ValidationIssue(IssueKind::VotedForWithoutVote,
+                                                  voters.ids[i], choice), cap);
+                    }
+                    continue;
+                }
+                int c = candidateIndex.find(choice);
+                if (c < 0) {
+                    found.add(ValidationIssue(IssueKind::UnknownVotedFor, voters.ids[i], choice), cap);
+                } else if (candidates[c].region.id() != region) {
+                    found.add(ValidationIssue(IssueKind::WrongRegionVote, voters.ids[i], choice), cap);
+                } else {
+                    votes[c]++;
+                }
+            }
+        }, threads);
+        
+        Findings duplicates;
+        duplicateIds(voters.ids, cap, threads, duplicates);
+        
+        // Recounts against the stored tallies
+        vector<int> votes(nc, 0), roll(nr, 0);
+        for (size_t b = 0; b < blocks; b++) {
+            for (size_t i = 0; i < nc; i++) votes[i] += blockVotes[b][i];
+            for (size_t r = 0; r < nr; r++) roll[r] += blockRoll[b][r];
+        }
+        Findings totals;
+        for (size_t i = 0; i < nc; i++) {
+            if (occurrences[i] == 1 && candidates[i].votes != votes[i]) {
+                totals.add(ValidationIssue(IssueKind::CandidateVoteCount, candidates[i].id,
+                                           candidates[i].votes, votes[i]), cap);
+            }
+        }
+        for (size_t r = 0; r < nr; r++) {
+            if (regions[r].isRegistered() && regions[r].totalVoters != roll[r]) {
+                totals.add(ValidationIssue(IssueKind::RegionVoterCount, r,
+                                           regions[r].totalVoters, roll[r]), cap);
+            }
+        }
+        
+        // Merge in a fixed order, so the report does not depend on threads
+        ValidationReport report;
+        vector<const Findings*> all;
+        all.push_back(&candidateFindings);
+        all.push_back(&duplicates);
+        for (const auto& f : blockFindings) all.push_back(&f);
+        all.push_back(&totals);
+        
+        vector<size_t> kept(ISSUE_KIND_COUNT, 0);
+        for (const Findings* f : all) {
+            for (int k = 0; k < ISSUE_KIND_COUNT; k++) report.counts[k] += f->counts[k];
+            for (const auto& issue : f->issues) {
+                if (kept[(int)issue.kind]++ < cap) report.issues.push_back(issue);
+            }
+        }
+        stable_sort(report.issues.begin(), report.issues.end(),
+                    [](const ValidationIssue& a, const ValidationIssue& b) {
+                        return a.kind < b.kind;
+                    });
+        
+        report.candidatesChecked = nc;
+        report.votersChecked = nv;
+        report.elapsedMs = chrono::duration<double, milli>(
+            chrono::steady_clock::now() - start).count();
+        return report;
+    }
+};
+
+#endif // VALIDATION_H
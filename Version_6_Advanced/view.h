@@ -0,0 +1,47 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include "election.h"
+#include "votertable.h"
+#include <vector>
+#include <memory>
+
+using namespace std;
+
+// Point-in-time copy of everything castVote changes, taken by
+// ElectionDatabase::createView(). Analytics read a view instead of the
+// live database, so a long report sees one consistent state (stats,
+// candidate votes, region turnout and voted flags all agree) while votes
+// keep arriving.
+//
+// What castVote never touches (voter ids, names, ages, regions) is read
+// through voters, which shares the database's table; adding voters gives
+// the database a fresh copy, so the view's table never changes under it.
+// Vote times and choices are not part of the view.
+struct ElectionView {
+    vector<Candidate> candidates;   // votes as of the view
+    vector<int> ranking;            // indexes into candidates, most votes first
+    vector<Region> regions;         // dense by RegionName id; votesPolled as of the view
+    vector<RegionRace> regionRaces; // by RegionName id; indexes into candidates
+    int registeredRegions;
+    ElectionStats stats;
+    
+    // Region x party votes as of the view (cell r * partyStride + p), and
+    // per region the parties with candidates there, most votes first
+    size_t partyStride;
+    vector<int> regionPartyVotes;
+    vector<vector<int>> partyOrder;
+    
+    Bitmap voted;                   // voted flags as of the view, by voter slot
+    shared_ptr<const VoterTable> voters;
+    
+    ElectionView() : registeredRegions(0), partyStride(0) {}
+    
+    size_t voterCount() const { return voted.size(); }
+    
+    int partyVotesIn(size_t region, size_t party) const {
+        return regionPartyVotes[region * partyStride + party];
+    }
+};
+
+#endif // VIEW_H
@@ -0,0 +1,116 @@
+#ifndef VOTERTABLE_H
+#define VOTERTABLE_H
+
+#include "election.h"
+#include "bitmap.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ctime>
+
+using namespace std;
+
+// Columnar (struct-of-arrays) voter storage used by ElectionDatabase.
+//
+// Slot i of every column belongs to the same voter, so a scan that only
+// needs ages and the voted flag walks two dense arrays instead of dragging
+// whole Voter records (two strings and a time_t) through the cache.
+// Names are packed into one character buffer: name i is
+// nameData[nameOffsets[i], nameOffsets[i + 1]).
+struct VoterTable {
+    vector<int> ids;
+    vector<int> ages;
+    vector<int> regionIds;          // RegionName ids
+    Bitmap voted;                   // bit set once the voter has voted
+    vector<int> votedFor;
+    vector<time_t> voteTimes;
+    vector<char> nameData;
+    vector<size_t> nameOffsets;
+    
+    VoterTable() : nameOffsets(1, 0) {}
+    
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+    
+    void reserve(size_t count, size_t nameBytes = 0) {
+        ids.reserve(count);
+        ages.reserve(count);
+        regionIds.reserve(count);
+        voted.reserve(count);
+        votedFor.reserve(count);
+        voteTimes.reserve(count);
+        nameOffsets.reserve(count + 1);
+        nameData.reserve(nameBytes);
+    }
+    
+    void append(const Voter& v) {
+        ids.push_back(v.id);
+        ages.push_back(v.age);
+        regionIds.push_back(v.region.id());
+        voted.push_back(v.hasVoted);
+        votedFor.push_back(v.votedFor);
+        voteTimes.push_back(v.voteTime);
+        nameData.insert(nameData.end(), v.name.begin(), v.name.end());
+        nameOffsets.push_back(nameData.size());
+    }
+    
+    // View into nameData; invalidated by the next append
+    string_view name(size_t slot) const {
+        return string_view(nameData.data() + nameOffsets[slot],
+                           nameOffsets[slot + 1] - nameOffsets[slot]);
+    }
+    
+    RegionName region(size_t slot) const {
+        return RegionName::fromId(regionIds[slot]);
+    }
+    
+    // Bitmap of the voters registered in any of the given regions, for
+    // use with voted.countAnd(); build once, reuse across queries
+    Bitmap regionMask(const vector<RegionName>& subset) const {
+        int maxId = -1;
+        for (const auto& r : subset) maxId = max(maxId, r.id());
+        vector<unsigned char> wanted(maxId + 1, 0);
+        for (const auto& r : subset) {
+            if (!r.isNull()) wanted[r.id()] = 1;
+        }
+        
+        Bitmap mask;
+        mask.reserve(size());
+        for (int r : regionIds) {
+            mask.push_back(r <= maxId && wanted[r]);
+        }
+        return mask;
+    }
+    
+    // castVote writes the vote columns (voted, votedFor, voteTimes) of
+    // other voters while lookups read them, so both sides go through these
+    template <typename T>
+    static T loadShared(const T& value) {
+#ifdef _MSC_VER
+        return *(const volatile T*)&value;
+#else
+        return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+#endif
+    }
+    
+    template <typename T>
+    static void storeShared(T& target, T value) {
+#ifdef _MSC_VER
+        *(volatile T*)&target = value;
+#else
+        __atomic_store_n(&target, value, __ATOMIC_RELEASE);
+#endif
+    }
+    
+    // Materialize one voter as a row record (for display, export and
+    // lookups; safe while votes are being cast)
+    Voter row(size_t slot) const {
+        Voter v(ids[slot], string(name(slot)), region(slot), ages[slot]);
+        v.hasVoted = voted.testAtomic(slot);
+        v.votedFor = loadShared(votedFor[slot]);
+        v.voteTime = loadShared(voteTimes[slot]);
+        return v;
+    }
+};
+
+#endif // VOTERTABLE_H
@@ -0,0 +1,155 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include "database.h"
+#include "parallel.h"
+#include "rng.h"
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+struct WorkloadOptions {
+    uint64_t seed;
+    double skew;            // Zipf exponent of candidate popularity (0 = uniform)
+    size_t batchSize;       // votes per castVotes call
+    unsigned threads;       // 0 = one per hardware thread
+    
+    WorkloadOptions() : seed(12345), skew(0.0), batchSize(4096), threads(0) {}
+};
+
+struct WorkloadResult {
+    size_t requested;
+    size_t generated;       // fewer than requested when voters run out
+    size_t accepted;
+    double generateMs;
+    double castMs;
+    
+    WorkloadResult() : requested(0), generated(0), accepted(0), generateMs(0), castMs(0) {}
+    
+    double votesPerSecond() const {
+        return (castMs > 0) ? accepted * 1000.0 / castMs : 0.0;
+    }
+};
+
+// Seeded vote workload for driving the database, e.g. for benchmarks.
+//
+// generate() picks distinct voters who have not voted (a partial shuffle
+// of the eligible voters) and gives each a candidate of their own region.
+// Within a region candidates are ranked in a seeded random order and the
+// k-th most popular is chosen with weight 1 / k^skew. The same seed and
+// database give the same votes whatever the thread count.
+//
+// cast() splits the votes into batches and applies them with concurrent
+// castVotes calls, which only meet at the lock-free counters.
+class VoteWorkload {
+private:
+    struct RegionChoice {
+        vector<int> candidateIds;   // most popular first
+        vector<double> cumulative;  // running sum of their weights
+        
+        int pick(FastRng& rng) const {
+            double u = rng.uniform() * cumulative.back();
+            size_t k = upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+            return candidateIds[min(k, candidateIds.size() - 1)];
+        }
+    };
+    
+    static double elapsedMs(chrono::steady_clock::time_point start) {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+public:
+    static vector<VoteRequest> generate(const ElectionDatabase& db, size_t numVotes,
+                                        const WorkloadOptions& options = WorkloadOptions()) {
+        FastRng setup(options.seed, 0);
+        
+        // Region -> candidates table, built once instead of per vote
+        vector<RegionChoice> choices(RegionName::count());
+        for (size_t r = 0; r < choices.size(); r++) {
+            CandidateSlice slice = db.getCandidatesByRegion(RegionName::fromId(r));
+            RegionChoice& choice = choices[r];
+            for (size_t i = 0; i < slice.size(); i++) {
+                choice.candidateIds.push_back(slice[i].id);
+            }
+            for (size_t i = choice.candidateIds.size(); i > 1; i--) {
+                swap(choice.candidateIds[i - 1], choice.candidateIds[setup.below(i)]);
+            }
+            double total = 0;
+            for (size_t k = 0; k < choice.candidateIds.size(); k++) {
+                total += 1.0 / pow((double)(k + 1), options.skew);
+                choice.cumulative.push_back(total);
+            }
+        }
+        
+        // Voters who can still vote, in slot order
+        const VoterTable& voters = db.getVoterTable();
+        vector<int> eligible;
+        for (size_t i = 0; i < voters.size(); i++) {
+            int region = voters.regionIds[i];
+            if (!voters.voted.testAtomic(i) && region < (int)choices.size() &&
+                !choices[region].candidateIds.empty()) {
+                eligible.push_back(i);
+            }
+        }
+        
+        // Partial Fisher-Yates: only the first numVotes positions are drawn
+        size_t n = min(numVotes, eligible.size());
+        for (size_t i = 0; i < n; i++) {
+            swap(eligible[i], eligible[i + setup.below(eligible.size() - i)]);
+        }
+        
+        vector<VoteRequest> votes(n);
+        const size_t block = 1 << 16;
+        ParallelUtils::forEach((n + block - 1) / block, [&](size_t b) {
+            FastRng rng(options.seed, b + 1);
+            size_t end = min(n, (b + 1) * block);
+            for (size_t i = b * block; i < end; i++) {
+                int slot = eligible[i];
+                votes[i] = VoteRequest(voters.ids[slot], choices[voters.regionIds[slot]].pick(rng));
+            }
+        }, options.threads);
+        return votes;
+    }
+    
+    // Apply votes in batches of options.batchSize from options.threads
+    // workers. Returns the number accepted.
+    static size_t cast(ElectionDatabase& db, const vector<VoteRequest>& votes,
+                       const WorkloadOptions& options = WorkloadOptions()) {
+        size_t batch = max<size_t>(1, options.batchSize);
+        size_t batches = (votes.size() + batch - 1) / batch;
+        vector<size_t> accepted(batches, 0);
+        time_t when = time(nullptr);
+        
+        ParallelUtils::forEach(batches, [&](size_t b) {
+            size_t count = min(batch, votes.size() - b * batch);
+            vector<VoteStatus> status = db.castVotes(votes.data() + b * batch, count, when);
+            accepted[b] = std::count(status.begin(), status.end(), VoteStatus::Accepted);
+        }, options.threads);
+        
+        size_t total = 0;
+        for (size_t a : accepted) total += a;
+        return total;
+    }
+    
+    static WorkloadResult run(ElectionDatabase& db, size_t numVotes,
+                              const WorkloadOptions& options = WorkloadOptions()) {
+        WorkloadResult result;
+        result.requested = numVotes;
+        
+        auto start = chrono::steady_clock::now();
+        vector<VoteRequest> votes = generate(db, numVotes, options);
+        result.generateMs = elapsedMs(start);
+        result.generated = votes.size();
+        
+        start = chrono::steady_clock::now();
+        result.accepted = cast(db, votes, options);
+        result.castMs = elapsedMs(start);
+        return result;
+    }
+};
+
+#endif // WORKLOAD_H